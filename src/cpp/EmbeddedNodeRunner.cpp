@@ -3,16 +3,31 @@
 #include <QFileInfo>
 #include <QCoreApplication>
 #include <iostream>
+#include "sharedring.h"
 
 #ifdef Q_OS_UNIX
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
+namespace {
+
+// 共享内存环形缓冲区的容量，能同时容纳若干张全屏截图
+const quint32 kSharedRingSize = 64 * 1024 * 1024;
+
+} // namespace
+
 EmbeddedNodeRunner::EmbeddedNodeRunner(QObject *parent)
     : QObject(parent)
     , m_nodeProcess(nullptr)
     , m_tempDir(nullptr)
     , m_useEmbeddedNode(false)
+    , m_clientDescriptor(-1)
+    , m_childDescriptor(-1)
+    , m_sharedRingDescriptor(-1)
+    , m_childSharedRingDescriptor(-1)
 {
     // 创建临时目录
     m_tempDir = new QTemporaryDir();
@@ -27,6 +42,7 @@ EmbeddedNodeRunner::EmbeddedNodeRunner(QObject *parent)
 EmbeddedNodeRunner::~EmbeddedNodeRunner()
 {
     stopNode();
+    closeDescriptors();
     delete m_tempDir;
 }
 
@@ -90,7 +106,13 @@ bool EmbeddedNodeRunner::startEmbeddedNode(const QString &nodeDir)
     arguments << m_nodeScript;
     arguments << "--node-dir" << m_currentNodeDir;
 
-    // 7. 启动进程
+    // 7. 本地连接方式，TCP端口仍然监听作为后备
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    prepareLocalTransport(&environment);
+    prepareSharedRing(&environment);
+    m_nodeProcess->setProcessEnvironment(environment);
+
+    // 8. 启动进程
     std::cout << "[EmbeddedNode] Starting Node.js..." << std::endl;
     std::cout << "[EmbeddedNode] Executable: " << m_nodeExecutable.toStdString() << std::endl;
     std::cout << "[EmbeddedNode] Script: " << m_nodeScript.toStdString() << std::endl;
@@ -98,7 +120,18 @@ bool EmbeddedNodeRunner::startEmbeddedNode(const QString &nodeDir)
 
     m_nodeProcess->start(m_nodeExecutable, arguments);
     
-    if (!m_nodeProcess->waitForStarted(5000)) {
+    bool started = m_nodeProcess->waitForStarted(5000);
+#ifdef Q_OS_UNIX
+    // 子进程已经继承了自己的一端和共享内存
+    for (qintptr *descriptor : {&m_childDescriptor, &m_childSharedRingDescriptor}) {
+        if (*descriptor >= 0) {
+            ::close(static_cast<int>(*descriptor));
+            *descriptor = -1;
+        }
+    }
+#endif
+    if (!started) {
+        closeDescriptors();
         emit nodeError("Failed to start Node.js process within 5 seconds");
         return false;
     }
@@ -133,6 +166,80 @@ QString EmbeddedNodeRunner::getTempPath() const
     return m_extractedPath;
 }
 
+TransportEndpoint EmbeddedNodeRunner::takeClientEndpoint()
+{
+    TransportEndpoint endpoint;
+    if (m_clientDescriptor >= 0) {
+        endpoint = TransportEndpoint::inherited(m_clientDescriptor, m_localServerName);
+        m_clientDescriptor = -1;
+    } else if (!m_localServerName.isEmpty()) {
+        endpoint = TransportEndpoint::local(m_localServerName);
+    }
+    if (endpoint.kind != TransportEndpoint::Kind::Tcp) {
+        endpoint.sharedMemoryDescriptor = m_sharedRingDescriptor;
+    }
+    return endpoint;
+}
+
+void EmbeddedNodeRunner::prepareLocalTransport(QProcessEnvironment *environment)
+{
+    closeDescriptors();
+#ifdef Q_OS_WIN
+    // QLocalSocket按名字连接\\.\pipe\下的命名管道
+    m_localServerName = QString("ai-agent-%1").arg(QCoreApplication::applicationPid());
+    environment->insert("AGENT_IPC_PATH", "\\\\.\\pipe\\" + m_localServerName);
+#else
+    QString socketDir = m_tempDir && m_tempDir->isValid() ? m_extractedPath : QDir::tempPath();
+    m_localServerName = QString("%1/ai-agent-%2.sock").arg(socketDir).arg(QCoreApplication::applicationPid());
+    environment->insert("AGENT_IPC_PATH", m_localServerName);
+
+    int descriptors[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors) != 0) {
+        qWarning() << "Failed to create socketpair, using local socket only";
+        return;
+    }
+    // 本端不让子进程继承，子进程端按原编号继承
+    ::fcntl(descriptors[0], F_SETFD, FD_CLOEXEC);
+    m_clientDescriptor = descriptors[0];
+    m_childDescriptor = descriptors[1];
+    environment->insert("AGENT_IPC_FD", QString::number(descriptors[1]));
+#endif
+}
+
+void EmbeddedNodeRunner::prepareSharedRing(QProcessEnvironment *environment)
+{
+#ifdef Q_OS_UNIX
+    m_sharedRingDescriptor = SharedRing::create(kSharedRingSize);
+    if (m_sharedRingDescriptor < 0) {
+        qWarning() << "Failed to create shared memory ring, large payloads go through the socket";
+        return;
+    }
+    // dup出的副本不带FD_CLOEXEC，子进程按这个编号继承
+    m_childSharedRingDescriptor = ::dup(static_cast<int>(m_sharedRingDescriptor));
+    if (m_childSharedRingDescriptor < 0) {
+        ::close(static_cast<int>(m_sharedRingDescriptor));
+        m_sharedRingDescriptor = -1;
+        return;
+    }
+    environment->insert("AGENT_SHM_FD", QString::number(m_childSharedRingDescriptor));
+#else
+    Q_UNUSED(environment);
+#endif
+}
+
+void EmbeddedNodeRunner::closeDescriptors()
+{
+#ifdef Q_OS_UNIX
+    for (qintptr *descriptor : {&m_clientDescriptor, &m_childDescriptor,
+                                &m_sharedRingDescriptor, &m_childSharedRingDescriptor}) {
+        if (*descriptor >= 0) {
+            ::close(static_cast<int>(*descriptor));
+            *descriptor = -1;
+        }
+    }
+#endif
+}
+
 bool EmbeddedNodeRunner::extractEmbeddedFiles()
 {
     if (!m_tempDir || !m_tempDir->isValid()) {
@@ -10,6 +10,8 @@
 #include <QFile>
 #include <QResource>
 #include <QStandardPaths>
+#include <QProcessEnvironment>
+#include "transport.h"
 
 class EmbeddedNodeRunner : public QObject
 {
@@ -31,6 +33,11 @@ public:
     // 获取临时目录路径
     QString getTempPath() const;
 
+    // 连接子进程的地址：Unix上是启动时继承给子进程的socketpair（断开后改连本地套接字），
+    // 其他平台是本地套接字（命名管道）；未启动时返回空地址
+    // socketpair的本端描述符交给调用方，只能取一次；共享内存描述符仍归本对象
+    TransportEndpoint takeClientEndpoint();
+
 signals:
     void nodeStarted();
     void nodeStopped();
@@ -57,6 +64,12 @@ private:
     // 设置文件权限（Unix/Linux/macOS）
     bool setExecutablePermissions(const QString &filePath);
 
+    // 准备本地套接字地址和socketpair，通过环境变量告诉子进程
+    void prepareLocalTransport(QProcessEnvironment *environment);
+    // 创建与子进程共享的内存环形缓冲区，通过环境变量告诉子进程
+    void prepareSharedRing(QProcessEnvironment *environment);
+    void closeDescriptors();
+
 private:
     QProcess *m_nodeProcess;
     QTemporaryDir *m_tempDir;
@@ -65,6 +78,11 @@ private:
     QString m_extractedPath;
     bool m_useEmbeddedNode;
     QString m_currentNodeDir;
+    QString m_localServerName;
+    qintptr m_clientDescriptor; // socketpair的本端
+    qintptr m_childDescriptor;  // socketpair的子进程端，子进程启动后本进程关闭
+    qintptr m_sharedRingDescriptor;      // 共享内存，客户端连接时映射
+    qintptr m_childSharedRingDescriptor; // 共享内存给子进程继承的副本，子进程启动后本进程关闭
 };
 
 #endif // EMBEDDEDNODERUNNER_H 
\ No newline at end of file
@@ -0,0 +1,1108 @@
+// 协议热点路径的性能测试，默认不编译：cmake -DBUILD_BENCHMARKS=ON 后运行 clientbench
+// 纯计算部分（校验、编解码、压缩、等待表、时间轮）直接调用对应模块；
+// 其余各项在本机连接一个进程内的最小对端，走完整的TcpClient收发路径，不需要启动Node服务
+// 各项结果只在同一台机器上互相比较有意义
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMap>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QtEndian>
+#include <QUuid>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <thread>
+#include "compression.h"
+#include "crc32c.h"
+#include "framecodec.h"
+#include "messages.h"
+#include "messageview.h"
+#include "pendingrequesttable.h"
+#include "sharedring.h"
+#include "tcpclient.h"
+#include "threadedtcpclient.h"
+#include "timerwheel.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 防止编译器把被测调用当作无用代码删掉
+volatile quint64 g_sink = 0;
+
+double perSecond(qint64 count, qint64 nsecs)
+{
+    return nsecs > 0 ? count * 1e9 / nsecs : 0;
+}
+
+double nsPerOp(qint64 nsecs, qint64 count)
+{
+    return count > 0 ? static_cast<double>(nsecs) / count : 0;
+}
+
+QString sizeName(qint64 bytes)
+{
+    if (bytes >= 1024 * 1024) {
+        return QString("%1MB").arg(bytes / (1024 * 1024));
+    }
+    if (bytes >= 1024) {
+        return QString("%1KB").arg(bytes / 1024);
+    }
+    return QString("%1B").arg(bytes);
+}
+
+// 样本的p50、p99和最大值，单位毫秒
+struct Percentiles
+{
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+Percentiles percentiles(QVector<qint64> samplesNs)
+{
+    Percentiles result;
+    if (samplesNs.isEmpty()) {
+        return result;
+    }
+    std::sort(samplesNs.begin(), samplesNs.end());
+    auto at = [&samplesNs](double q) {
+        int index = qMin(static_cast<int>(samplesNs.size()) - 1, static_cast<int>(q * samplesNs.size()));
+        return samplesNs.at(index) / 1e6;
+    };
+    result.p50 = at(0.5);
+    result.p99 = at(0.99);
+    result.max = samplesNs.last() / 1e6;
+    return result;
+}
+
+// /proc/self/status中的VmRSS、VmHWM，单位KB；其他平台返回-1
+qint64 procStatusKb(const char *field)
+{
+#ifdef Q_OS_LINUX
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (status.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> lines = status.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            if (line.startsWith(field)) {
+                return line.mid(static_cast<int>(qstrlen(field))).trimmed().split(' ').value(0).toLongLong();
+            }
+        }
+    }
+#else
+    Q_UNUSED(field);
+#endif
+    return -1;
+}
+
+// 把峰值RSS重置为当前RSS（Linux 4.0起）
+void resetPeakRss()
+{
+#ifdef Q_OS_LINUX
+    QFile clearRefs(QStringLiteral("/proc/self/clear_refs"));
+    if (clearRefs.open(QIODevice::WriteOnly)) {
+        clearRefs.write("5");
+    }
+#endif
+}
+
+QByteArray makeJsonPayload(int dataBytes)
+{
+    QJsonObject data;
+    data["command"] = QString(dataBytes, QLatin1Char('x'));
+    data["type"] = QStringLiteral("browser");
+    QJsonObject message;
+    message["event"] = QStringLiteral("execute_command");
+    message["requestId"] = 123456;
+    message["data"] = data;
+    return QJsonDocument(message).toJson(QJsonDocument::Compact);
+}
+
+// 可压缩的文本：重复的JSON片段加上递增数字
+QByteArray makeTextPayload(int bytes)
+{
+    QByteArray text;
+    text.reserve(bytes + 64);
+    for (int i = 0; text.size() < bytes; ++i) {
+        text += "{\"role\":\"assistant\",\"step\":";
+        text += QByteArray::number(i);
+        text += ",\"status\":\"running\"},";
+    }
+    text.truncate(bytes);
+    return text;
+}
+
+// 不可压缩的二进制数据，模拟截图
+QByteArray makeImagePayload(int bytes)
+{
+    QByteArray image(bytes, Qt::Uninitialized);
+    std::mt19937 random(7);
+    for (int i = 0; i < bytes; ++i) {
+        image[i] = static_cast<char>(random());
+    }
+    return image;
+}
+
+// ---- 校验 ----
+
+double checksumGbPerSecond(const QByteArray &data, qint64 totalBytes, bool crc)
+{
+    qint64 rounds = qMax<qint64>(1, totalBytes / data.size());
+    QElapsedTimer timer;
+    timer.start();
+    for (qint64 i = 0; i < rounds; ++i) {
+        if (crc) {
+            g_sink += Crc32c::compute(data.constData(), static_cast<size_t>(data.size()));
+        } else {
+            g_sink += static_cast<quint8>(QCryptographicHash::hash(data, QCryptographicHash::Sha256).at(0));
+        }
+    }
+    return perSecond(rounds * data.size(), timer.nsecsElapsed()) / 1e9;
+}
+
+void benchChecksum()
+{
+    std::printf("\n[校验] CRC32C %s 与旧版SHA-256截断校验，GB/s\n",
+                Crc32c::isHardwareAccelerated() ? "(硬件加速)" : "(查表)");
+    for (int size : {1024, 64 * 1024, 4 * 1024 * 1024}) {
+        QByteArray data = makeTextPayload(size);
+        std::printf("  %6s  crc32c %7.2f  sha256 %7.2f\n", qPrintable(sizeName(size)),
+                    checksumGbPerSecond(data, 512 * 1024 * 1024, true),
+                    checksumGbPerSecond(data, 64 * 1024 * 1024, false));
+    }
+}
+
+// ---- 帧编解码 ----
+
+// 旧版解码方式：逐帧拷贝出负载，再从缓冲区头部移除这一帧，剩余数据每帧移动一次
+int decodeByRemove(QByteArray buffer)
+{
+    const int headerSize = Protocol::SyncMarkerSize + Protocol::HeaderSize;
+    int decoded = 0;
+    while (buffer.size() >= headerSize) {
+        int payloadLength = static_cast<int>(Protocol::readUInt32BE(buffer.constData() + Protocol::SyncMarkerSize));
+        int frameSize = headerSize + payloadLength + Protocol::ChecksumFieldSize;
+        if (buffer.size() < frameSize) {
+            break;
+        }
+        QByteArray checked = buffer.mid(Protocol::SyncMarkerSize + Protocol::LengthFieldSize,
+                                         Protocol::TypeFieldSize + payloadLength);
+        quint32 checksum = Protocol::readUInt32BE(buffer.constData() + headerSize + payloadLength);
+        decoded += Crc32c::compute(checked.constData(), static_cast<size_t>(checked.size())) == checksum ? 1 : 0;
+        buffer.remove(0, frameSize);
+    }
+    return decoded;
+}
+
+void benchCodec()
+{
+    std::printf("\n[编解码] 编码后写入连续缓冲区，再按64KB分段喂给解码器\n");
+    for (Protocol::ChecksumMode mode : {Protocol::ChecksumMode::Crc32c, Protocol::ChecksumMode::Sha256}) {
+        for (int dataBytes : {128, 16 * 1024}) {
+            FrameEncoding encoding;
+            encoding.checksum = mode;
+            encoding.syncMarker = true;
+            QByteArray payload = makeJsonPayload(dataBytes);
+            const int frames = qMax(2000, static_cast<int>((64 * 1024 * 1024) / payload.size()));
+
+            QByteArray stream;
+            stream.reserve(static_cast<int>(qMin<qint64>(static_cast<qint64>(frames) * (payload.size() + 16),
+                                                         512 * 1024 * 1024)));
+            QElapsedTimer timer;
+            timer.start();
+            for (int i = 0; i < frames; ++i) {
+                FrameEncoder::encode(Protocol::PayloadJson, encoding, payload).appendTo(&stream, true);
+            }
+            qint64 encodeNs = timer.nsecsElapsed();
+
+            FrameDecoder decoder;
+            FrameView frame;
+            int decoded = 0;
+            timer.restart();
+            for (int offset = 0; offset < stream.size(); offset += 64 * 1024) {
+                decoder.append(stream.constData() + offset, qMin(64 * 1024, static_cast<int>(stream.size()) - offset));
+                while (decoder.nextFrame(&frame)) {
+                    decoded += frame.checksumValid ? 1 : 0;
+                }
+                decoder.compact();
+            }
+            qint64 decodeNs = timer.nsecsElapsed();
+
+            std::printf("  %-6s 负载%6d字节  编码 %9.0f 帧/s %8.2f MB/s  解码 %9.0f 帧/s %8.2f MB/s%s\n",
+                        qPrintable(Protocol::checksumModeName(mode)), static_cast<int>(payload.size()),
+                        perSecond(frames, encodeNs), perSecond(stream.size(), encodeNs) / 1e6,
+                        perSecond(decoded, decodeNs), perSecond(stream.size(), decodeNs) / 1e6,
+                        decoded == frames ? "" : "  (校验失败)");
+        }
+    }
+
+    // 一次读到10000个流水线帧：解析完整批只compact一次，与逐帧移除的旧方式对比
+    {
+        FrameEncoding encoding;
+        encoding.checksum = Protocol::ChecksumMode::Crc32c;
+        encoding.syncMarker = true;
+        QByteArray payload = makeJsonPayload(128);
+        const int frames = 10000;
+        QByteArray stream;
+        for (int i = 0; i < frames; ++i) {
+            FrameEncoder::encode(Protocol::PayloadJson, encoding, payload).appendTo(&stream, true);
+        }
+
+        const int rounds = 20;
+        int decoded = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (int r = 0; r < rounds; ++r) {
+            FrameDecoder decoder;
+            FrameView frame;
+            decoder.append(stream.constData(), static_cast<int>(stream.size()));
+            while (decoder.nextFrame(&frame)) {
+                decoded += frame.checksumValid ? 1 : 0;
+            }
+            decoder.compact();
+        }
+        qint64 viewNs = timer.nsecsElapsed();
+
+        int removed = 0;
+        timer.restart();
+        for (int r = 0; r < rounds; ++r) {
+            removed += decodeByRemove(stream);
+        }
+        qint64 removeNs = timer.nsecsElapsed();
+        std::printf("  一次读入%d帧(%s)  FrameDecoder %6.0f ns/帧  逐帧移除 %6.0f ns/帧%s\n", frames,
+                    qPrintable(sizeName(stream.size())), nsPerOp(viewNs, static_cast<qint64>(rounds) * frames),
+                    nsPerOp(removeNs, static_cast<qint64>(rounds) * frames),
+                    decoded == rounds * frames && removed == rounds * frames ? "" : "  (校验失败)");
+    }
+
+    // 路由只需要event和requestId：按需解析与完整解析JSON的对比
+    QByteArray json = makeJsonPayload(1024);
+    const int rounds = 200000;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < rounds; ++i) {
+        MessageView view(json);
+        g_sink += view.requestId() + static_cast<quint64>(view.eventBytes().size());
+    }
+    qint64 viewNs = timer.nsecsElapsed();
+    timer.restart();
+    for (int i = 0; i < rounds; ++i) {
+        QJsonObject object = QJsonDocument::fromJson(json).object();
+        g_sink += static_cast<quint64>(object["requestId"].toDouble()) + object["event"].toString().size();
+    }
+    qint64 parseNs = timer.nsecsElapsed();
+    std::printf("  路由%d字节消息  MessageView %7.0f ns  QJsonDocument %7.0f ns\n",
+                static_cast<int>(json.size()), nsPerOp(viewNs, rounds), nsPerOp(parseNs, rounds));
+}
+
+// ---- 压缩 ----
+
+void benchCompression()
+{
+    std::printf("\n[压缩] 64KB文本\n");
+    QByteArray text = makeTextPayload(64 * 1024);
+    const int rounds = 500;
+    for (Protocol::CompressionCodec codec : Compression::availableCodecs()) {
+        if (codec == Protocol::CompressionCodec::None) {
+            continue;
+        }
+        QByteArray compressed;
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < rounds; ++i) {
+            Compression::compress(codec, text.constData(), text.size(), &compressed);
+        }
+        qint64 compressNs = timer.nsecsElapsed();
+
+        QByteArray restored;
+        bool ok = true;
+        timer.restart();
+        for (int i = 0; i < rounds; ++i) {
+            ok = Compression::decompress(codec, compressed.constData(), compressed.size(),
+                                         text.size(), &restored) && ok;
+        }
+        qint64 decompressNs = timer.nsecsElapsed();
+
+        std::printf("  %-8s 压缩率 %5.1f%%  压缩 %8.2f MB/s  解压 %8.2f MB/s%s\n",
+                    qPrintable(Compression::codecName(codec)), 100.0 * compressed.size() / text.size(),
+                    perSecond(static_cast<qint64>(rounds) * text.size(), compressNs) / 1e6,
+                    perSecond(static_cast<qint64>(rounds) * text.size(), decompressNs) / 1e6,
+                    ok && restored == text ? "" : "  (解压结果不一致)");
+    }
+}
+
+// ---- 等待表 ----
+
+// 稳态：始终有10000个请求在等待，每次生成ID、插入一个新请求并取出最早的一个
+// 旧版以QUuid字符串为请求ID，回调存放在QMap<QString, ...>中
+void benchPendingTable()
+{
+    std::printf("\n[等待表] 10000个请求在等待，生成ID+插入+取出，ns/次\n");
+    const int window = 10000;
+    const int rounds = 1000000;
+
+    PendingRequestTable table;
+    RequestId nextId = 1;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < rounds; ++i) {
+        RequestId id = nextId++;
+        table.insert(id, [](const QJsonObject &) {}, id);
+        if (id > static_cast<RequestId>(window)) {
+            ResponseCallback callback = table.take(id - window);
+            g_sink += callback ? 1 : 0;
+        }
+    }
+    qint64 tableNs = timer.nsecsElapsed();
+
+    QMap<QString, ResponseCallback> map;
+    QVector<QString> inFlight(window);
+    timer.restart();
+    for (int i = 0; i < rounds; ++i) {
+        QString id = QUuid::createUuid().toString();
+        map.insert(id, [](const QJsonObject &) {});
+        QString &oldest = inFlight[i % window];
+        if (!oldest.isEmpty()) {
+            ResponseCallback callback = map.take(oldest);
+            g_sink += callback ? 1 : 0;
+        }
+        oldest = id;
+    }
+    qint64 mapNs = timer.nsecsElapsed();
+
+    std::printf("  PendingRequestTable %7.1f  QMap<QString>+QUuid %7.1f\n",
+                nsPerOp(tableNs, rounds), nsPerOp(mapNs, rounds));
+}
+
+// ---- 时间轮 ----
+
+void benchTimerWheel()
+{
+    std::printf("\n[时间轮] 1ms刻度，超时时间均匀分布在1-200ms\n");
+    const int keys = 500000;
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> delay(1, 200);
+
+    TimerWheel wheel(1, 512);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < keys; ++i) {
+        wheel.schedule(static_cast<quint64>(i), delay(random));
+    }
+    qint64 scheduleNs = timer.nsecsElapsed();
+
+    QVector<quint64> expired;
+    qint64 advanceNs = 0;
+    int advances = 0;
+    int fired = 0;
+    QElapsedTimer wall;
+    wall.start();
+    while (!wheel.isEmpty() && !wall.hasExpired(5000)) {
+        timer.restart();
+        wheel.advance(&expired);
+        advanceNs += timer.nsecsElapsed();
+        ++advances;
+        fired += expired.size();
+        expired.clear();
+    }
+    std::printf("  schedule %6.1f ns/个  advance共%d次 %6.1f ns/到期项  到期%d/%d\n",
+                nsPerOp(scheduleNs, keys), advances, nsPerOp(advanceNs, fired), fired, keys);
+}
+
+// ---- 进程内对端 ----
+
+#ifdef Q_OS_UNIX
+// 共享内存写端，与Node端utils/shared-ring.ts相同：pwrite写数据，pread读位置
+class RingWriter
+{
+public:
+    ~RingWriter()
+    {
+        if (m_descriptor >= 0) {
+            ::close(static_cast<int>(m_descriptor));
+        }
+    }
+
+    bool open(quint32 capacity)
+    {
+        m_descriptor = SharedRing::create(capacity);
+        m_capacity = capacity;
+        return m_descriptor >= 0;
+    }
+
+    qintptr descriptor() const { return m_descriptor; }
+
+    // 空间不足时返回false
+    bool write(const QByteArray &data, quint32 *position)
+    {
+        quint32 length = static_cast<quint32>(data.size());
+        quint32 start = m_writePosition;
+        quint32 offset = start & (m_capacity - 1);
+        if (offset + static_cast<quint64>(length) > m_capacity) {
+            start += m_capacity - offset;
+        }
+        if (static_cast<quint32>(start + length - readPosition()) > m_capacity) {
+            return false;
+        }
+        off_t at = SharedRing::HeaderSize + static_cast<off_t>(start & (m_capacity - 1));
+        if (::pwrite(static_cast<int>(m_descriptor), data.constData(), length, at) != static_cast<ssize_t>(length)) {
+            return false;
+        }
+        m_writePosition = start + length;
+        *position = start;
+        return true;
+    }
+
+private:
+    quint32 readPosition() const
+    {
+        uchar field[4] = {};
+        if (::pread(static_cast<int>(m_descriptor), field, sizeof(field), 12) != static_cast<ssize_t>(sizeof(field))) {
+            return m_writePosition;
+        }
+        return qFromLittleEndian<quint32>(field);
+    }
+
+    qintptr m_descriptor = -1;
+    quint32 m_capacity = 0;
+    quint32 m_writePosition = 0;
+};
+#endif
+
+// 进程内的最小对端：回复握手，解码客户端发来的帧，按消息计数
+// 批量帧拆开后逐条计数，与Node端的处理方式相同；echo时对带requestId的JSON请求回复同一个ID
+class LoopbackPeer
+{
+public:
+    enum class Kind { Tcp, Local, SocketPair };
+
+    std::function<void(const MessageView &message)> onMessage;
+    bool echo = false;
+    bool acceptChunks = true; // 握手时是否声明'C'
+    int frames = 0;
+    int messages = 0;
+    int binaryPayloads = 0; // 完整收到的二进制负载（整帧或分块流的最后一块）
+    qint64 bytes = 0;
+
+    ~LoopbackPeer()
+    {
+        if (m_localServer.isListening()) {
+            m_localServer.close();
+        }
+    }
+
+    // 开始监听，返回客户端应连接的地址；失败时返回的TCP地址端口为0
+    TransportEndpoint listen(Kind kind = Kind::Tcp)
+    {
+        if (kind == Kind::Local) {
+            QObject::connect(&m_localServer, &QLocalServer::newConnection, [this]() {
+                attach(m_localServer.nextPendingConnection());
+            });
+            QString name = QString("clientbench-%1").arg(QCoreApplication::applicationPid());
+            QLocalServer::removeServer(name);
+            m_localServer.listen(name);
+            return TransportEndpoint::local(name);
+        }
+#ifdef Q_OS_UNIX
+        if (kind == Kind::SocketPair) {
+            int descriptors[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors) != 0) {
+                return TransportEndpoint::tcp(QStringLiteral("127.0.0.1"), 0);
+            }
+            m_pairSocket.setSocketDescriptor(descriptors[0]);
+            attach(&m_pairSocket);
+            return TransportEndpoint::inherited(descriptors[1]);
+        }
+#endif
+        QObject::connect(&m_tcpServer, &QTcpServer::newConnection, [this]() {
+            attach(m_tcpServer.nextPendingConnection());
+        });
+        m_tcpServer.listen(QHostAddress::LocalHost, 0);
+        return TransportEndpoint::tcp(QStringLiteral("127.0.0.1"), m_tcpServer.serverPort());
+    }
+
+    void write(const EncodedFrame &frame)
+    {
+        frame.writeTo(m_device, m_encoding.syncMarker);
+    }
+
+    const FrameEncoding &encoding() const { return m_encoding; }
+
+private:
+    void attach(QIODevice *device)
+    {
+        m_device = device;
+        QObject::connect(device, &QIODevice::readyRead, [this]() { read(); });
+    }
+
+    void read()
+    {
+        QByteArray data = m_device->readAll();
+        bytes += data.size();
+        m_decoder.append(data.constData(), static_cast<int>(data.size()));
+        FrameView frame;
+        while (m_decoder.nextFrame(&frame)) {
+            ++frames;
+            if (frame.payloadType == Protocol::PayloadJson) {
+                handle(frame.payloadBytes());
+            } else if (frame.payloadType == Protocol::PayloadBatch) {
+                QList<QByteArray> items;
+                if (splitBatchPayload(frame, &items)) {
+                    for (const QByteArray &item : items) {
+                        handle(item);
+                    }
+                }
+            } else if (frame.payloadType == Protocol::PayloadChunk) {
+                ChunkView chunk;
+                if (splitChunkPayload(frame, &chunk) && chunk.final) {
+                    ++binaryPayloads;
+                }
+            } else if (Protocol::isBinaryPayloadType(frame.payloadType)) {
+                ++binaryPayloads;
+            }
+        }
+        m_decoder.compact();
+    }
+
+    void handle(const QByteArray &json)
+    {
+        MessageView message(json);
+        if (message.eventBytes() == "protocol_hello") {
+            replyHello();
+            return;
+        }
+        ++messages;
+        if (echo && message.hasRequestId()) {
+            QJsonObject reply;
+            reply["event"] = message.event() + QStringLiteral("_response");
+            reply["requestId"] = static_cast<qint64>(message.requestId());
+            reply["data"] = QJsonObject();
+            write(FrameEncoder::encode(Protocol::PayloadJson, m_encoding,
+                                       QJsonDocument(reply).toJson(QJsonDocument::Compact)));
+        }
+        if (onMessage) {
+            onMessage(message);
+        }
+    }
+
+    // 按版本2回复：CRC32C、不压缩；回复本身按旧版格式写出，之后的帧带同步标记
+    void replyHello()
+    {
+        QJsonArray payloadTypes{QStringLiteral("B"), QStringLiteral("I"), QStringLiteral("M")};
+        if (acceptChunks) {
+            payloadTypes.append(QStringLiteral("C"));
+        }
+        QJsonObject data;
+        data["version"] = Protocol::Version;
+        data["maxFrameSize"] = Protocol::DefaultMaxPayloadSize;
+        data["checksum"] = QStringLiteral("crc32c");
+        data["compression"] = QStringLiteral("none");
+        data["payloadTypes"] = payloadTypes;
+        QJsonObject reply;
+        reply["event"] = QStringLiteral("protocol_hello");
+        reply["data"] = data;
+        write(FrameEncoder::encode(Protocol::PayloadJson, m_encoding,
+                                   QJsonDocument(reply).toJson(QJsonDocument::Compact)));
+        m_encoding.checksum = Protocol::ChecksumMode::Crc32c;
+        m_encoding.syncMarker = true;
+    }
+
+    QTcpServer m_tcpServer;
+    QLocalServer m_localServer;
+    QLocalSocket m_pairSocket;
+    QIODevice *m_device = nullptr;
+    FrameDecoder m_decoder;
+    FrameEncoding m_encoding;
+};
+
+bool waitFor(const std::function<bool()> &condition, int timeoutMs = 30000)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!condition()) {
+        if (timer.hasExpired(timeoutMs)) {
+            return false;
+        }
+        QCoreApplication::processEvents();
+    }
+    return true;
+}
+
+bool connectLoopback(TcpClient *client, const TransportEndpoint &endpoint)
+{
+    bool negotiated = false;
+    QMetaObject::Connection connection = QObject::connect(
+        client, &TcpClient::protocolNegotiated, [&negotiated](const NegotiatedProtocol &) { negotiated = true; });
+    client->connectToServer(endpoint);
+    bool ok = waitFor([&negotiated]() { return negotiated; }, 5000);
+    QObject::disconnect(connection);
+    if (!ok) {
+        std::printf("  连接本地对端失败\n");
+    }
+    return ok;
+}
+
+// 三种方式都发送QJsonObject，sendBatch只接受这种形式
+QJsonObject calculateRequest(int a)
+{
+    QJsonObject data;
+    data["a"] = a;
+    data["b"] = 1;
+    QJsonObject request;
+    request["event"] = QLatin1String(CalculateRequest::event);
+    request["data"] = data;
+    return request;
+}
+
+// ---- 批量发送 ----
+
+enum class BatchMode { Single, Coalesced, Batched };
+
+// 发送count个小请求，直到对端收齐为止的耗时和帧数
+void runBatching(BatchMode mode, const char *name, int count)
+{
+    LoopbackPeer peer;
+    TcpClient client;
+    client.setLogLevel(TcpClient::LogLevel::Off);
+    if (!connectLoopback(&client, peer.listen())) {
+        return;
+    }
+    client.setWriteCoalescing(mode == BatchMode::Coalesced);
+    client.resetStats();
+    const int framesBefore = peer.frames;
+    const int messagesBefore = peer.messages;
+
+    const int batchSize = 64;
+    QElapsedTimer timer;
+    timer.start();
+    if (mode == BatchMode::Batched) {
+        for (int i = 0; i < count; i += batchSize) {
+            QVector<BatchRequest> batch;
+            for (int j = i; j < qMin(count, i + batchSize); ++j) {
+                batch.append({calculateRequest(j), ResponseCallback()});
+            }
+            client.sendBatch(batch);
+        }
+    } else {
+        for (int i = 0; i < count; ++i) {
+            client.sendRequest(calculateRequest(i), ResponseCallback());
+            // 合并写入在下一轮事件循环才写出，每64个请求让出一次，模拟请求分散在多轮事件中产生
+            if (i % batchSize == batchSize - 1) {
+                QCoreApplication::processEvents();
+            }
+        }
+    }
+    bool ok = waitFor([&peer, messagesBefore, count]() { return peer.messages - messagesBefore >= count; });
+    qint64 ns = timer.nsecsElapsed();
+
+    ClientStats stats = client.stats();
+    std::printf("  %-10s %8.0f 请求/s  对端收到%6d帧  客户端写出%8.0f字节%s\n", name,
+                perSecond(count, ns), peer.frames - framesBefore, static_cast<double>(stats.bytesSent),
+                ok ? "" : "  (超时)");
+    client.disconnectFromServer();
+}
+
+void benchBatching()
+{
+    std::printf("\n[批量发送] 本地回环，calculate请求\n");
+    const int count = 50000;
+    runBatching(BatchMode::Single, "逐条", count);
+    runBatching(BatchMode::Coalesced, "合并写入", count);
+    runBatching(BatchMode::Batched, "sendBatch", count);
+}
+
+// ---- 日志 ----
+
+// 请求-响应往返的吞吐，logMessage连接到一个只计数的槽，相当于界面收到日志但不显示
+void runLogging(TcpClient::LogLevel level, const char *name, int count)
+{
+    LoopbackPeer peer;
+    peer.echo = true;
+    TcpClient client;
+    client.setLogLevel(level);
+    quint64 logLines = 0;
+    QObject::connect(&client, &TcpClient::logMessage, [&logLines](const QString &message) {
+        logLines += message.isEmpty() ? 0 : 1;
+    });
+    if (!connectLoopback(&client, peer.listen())) {
+        return;
+    }
+    logLines = 0;
+
+    int responses = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < count; ++i) {
+        client.sendRequest(calculateRequest(i), [&responses](const QJsonObject &) { ++responses; });
+        if (i % 64 == 63) {
+            QCoreApplication::processEvents();
+        }
+    }
+    bool ok = waitFor([&responses, count]() { return responses >= count; });
+    qint64 ns = timer.nsecsElapsed();
+    std::printf("  %-6s %8.0f 请求/s  日志%8llu条%s\n", name, perSecond(count, ns),
+                static_cast<unsigned long long>(logLines), ok ? "" : "  (超时)");
+    client.disconnectFromServer();
+}
+
+void benchLogging()
+{
+    std::printf("\n[日志] 本地回环请求-响应吞吐，不同日志级别\n");
+    const int count = 20000;
+    runLogging(TcpClient::LogLevel::Off, "Off", count);
+    runLogging(TcpClient::LogLevel::Info, "Info", count);
+    runLogging(TcpClient::LogLevel::Frame, "Frame", count);
+}
+
+// ---- 控制消息 ----
+
+// 64MB负载发送期间每1ms发一条stop_agent，统计每条从发出到对端解码的延迟，以及期间的峰值RSS
+// 对端在同一进程内，峰值RSS也包括对端接收缓冲区的占用
+void runControlLane(const char *name, bool chunked, qint64 writeBudget)
+{
+    LoopbackPeer peer;
+    peer.acceptChunks = chunked;
+    TcpClient client;
+    client.setLogLevel(TcpClient::LogLevel::Off);
+    if (!connectLoopback(&client, peer.listen())) {
+        return;
+    }
+    client.setWriteBudget(writeBudget);
+
+    QElapsedTimer clock;
+    clock.start();
+    QHash<RequestId, qint64> sentAt;
+    QVector<qint64> latencies;
+    peer.onMessage = [&](const MessageView &message) {
+        if (message.eventBytes() == StopAgent::event) {
+            auto it = sentAt.constFind(message.requestId());
+            if (it != sentAt.constEnd()) {
+                latencies.append(clock.nsecsElapsed() - it.value());
+            }
+        }
+    };
+
+    QByteArray payload = makeImagePayload(64 * 1024 * 1024);
+    QTimer sampler;
+    sampler.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&sampler, &QTimer::timeout, [&]() {
+        qint64 now = clock.nsecsElapsed();
+        RequestId requestId = client.sendRequest(StopAgent(), ResponseCallback());
+        if (requestId != 0) {
+            sentAt.insert(requestId, now);
+        }
+    });
+
+    qint64 rssBefore = procStatusKb("VmRSS:");
+    resetPeakRss();
+    client.sendBinary(QStringLiteral("upload"), payload, ResponseCallback(), Protocol::PayloadBinary,
+                      QJsonObject(), RequestOptions::untimed());
+    sampler.start(1);
+    bool ok = waitFor([&peer]() { return peer.binaryPayloads >= 1; });
+    sampler.stop();
+    waitFor([&]() { return latencies.size() >= sentAt.size(); }, 5000);
+    qint64 peakRss = procStatusKb("VmHWM:");
+
+    Percentiles latency = percentiles(latencies);
+    std::printf("  %-18s 样本%4d  p50 %7.2f ms  p99 %7.2f ms  最大 %7.2f ms  峰值RSS +%6.1f MB%s\n", name,
+                static_cast<int>(latencies.size()), latency.p50, latency.p99, latency.max,
+                peakRss >= 0 && rssBefore >= 0 ? (peakRss - rssBefore) / 1024.0 : 0.0, ok ? "" : "  (超时)");
+    client.disconnectFromServer();
+}
+
+void benchControlLane()
+{
+    std::printf("\n[控制消息] 64MB二进制负载发送期间的stop_agent延迟\n");
+    runControlLane("分块，写入预算256KB", true, 256 * 1024);
+    runControlLane("分块，不限预算", true, 256 * 1024 * 1024);
+    runControlLane("整帧（对端不分块）", false, 256 * 1024);
+}
+
+// ---- 传输方式 ----
+
+// 顺序请求-响应的往返时间，以及1MB二进制负载的单向吞吐
+void runTransport(LoopbackPeer::Kind kind, const char *name)
+{
+    LoopbackPeer peer;
+    peer.echo = true;
+    TcpClient client;
+    client.setLogLevel(TcpClient::LogLevel::Off);
+    if (!connectLoopback(&client, peer.listen(kind))) {
+        return;
+    }
+
+    const int rounds = 5000;
+    QVector<qint64> rtts;
+    rtts.reserve(rounds);
+    QElapsedTimer timer;
+    for (int i = 0; i < rounds; ++i) {
+        bool done = false;
+        timer.start();
+        client.sendRequest(calculateRequest(i), [&done](const QJsonObject &) { done = true; });
+        if (!waitFor([&done]() { return done; }, 5000)) {
+            break;
+        }
+        rtts.append(timer.nsecsElapsed());
+    }
+
+    const int blocks = 256;
+    QByteArray block = makeImagePayload(1024 * 1024);
+    const int payloadsBefore = peer.binaryPayloads;
+    timer.start();
+    for (int i = 0; i < blocks; ++i) {
+        client.sendBinary(QStringLiteral("upload"), block, ResponseCallback(), Protocol::PayloadBinary,
+                          QJsonObject(), RequestOptions::untimed());
+    }
+    bool ok = waitFor([&peer, payloadsBefore]() { return peer.binaryPayloads - payloadsBefore >= blocks; });
+    qint64 ns = timer.nsecsElapsed();
+
+    Percentiles rtt = percentiles(rtts);
+    std::printf("  %-10s RTT p50 %6.1f us  p99 %6.1f us  吞吐 %8.1f MB/s%s\n", name, rtt.p50 * 1000,
+                rtt.p99 * 1000, perSecond(static_cast<qint64>(blocks) * block.size(), ns) / 1e6,
+                ok && rtts.size() == rounds ? "" : "  (超时)");
+    client.disconnectFromServer();
+}
+
+void benchTransports()
+{
+    std::printf("\n[传输方式] 本机\n");
+    runTransport(LoopbackPeer::Kind::Tcp, "TCP");
+    runTransport(LoopbackPeer::Kind::Local, "本地套接字");
+#ifdef Q_OS_UNIX
+    runTransport(LoopbackPeer::Kind::SocketPair, "socketpair");
+#endif
+}
+
+// ---- 截图 ----
+
+enum class ScreenshotPath { Frame, Chunks, Shared };
+
+// 4MB截图从对端开始编码到客户端发出binaryMessage的延迟，以及每张截图经过socket的字节数
+// 整帧和分块的数据都经过socket，客户端从socket读出、解码时各拷贝一次；共享内存只有描述符经过socket
+void runScreenshots(ScreenshotPath path, const char *name)
+{
+    LoopbackPeer peer;
+    TransportEndpoint endpoint = peer.listen();
+#ifdef Q_OS_UNIX
+    RingWriter ring;
+    if (path == ScreenshotPath::Shared) {
+        if (!ring.open(64 * 1024 * 1024)) {
+            std::printf("  %-8s 创建共享内存失败\n", name);
+            return;
+        }
+        endpoint.sharedMemoryDescriptor = ring.descriptor();
+    }
+#else
+    if (path == ScreenshotPath::Shared) {
+        return;
+    }
+#endif
+    TcpClient client;
+    client.setLogLevel(TcpClient::LogLevel::Off);
+    if (!connectLoopback(&client, endpoint)) {
+        return;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 sentAt = 0;
+    QVector<qint64> latencies;
+    QObject::connect(&client, &TcpClient::binaryMessage,
+                     [&](char, const QJsonObject &, const QByteArray &data) {
+                         g_sink += static_cast<quint8>(data.at(data.size() - 1));
+                         latencies.append(clock.nsecsElapsed() - sentAt);
+                     });
+
+    const int screenshots = 20;
+    const int chunkSize = Protocol::DefaultChunkSize;
+    QByteArray image = makeImagePayload(4 * 1024 * 1024);
+    client.resetStats();
+    bool ok = true;
+    for (int i = 0; i < screenshots && ok; ++i) {
+        QJsonObject meta;
+        meta["event"] = QStringLiteral("agent_screenshot");
+        sentAt = clock.nsecsElapsed();
+        if (path == ScreenshotPath::Frame) {
+            peer.write(FrameEncoder::encodeBinary(Protocol::PayloadImage, peer.encoding(),
+                                                  QJsonDocument(meta).toJson(QJsonDocument::Compact), image));
+        } else if (path == ScreenshotPath::Chunks) {
+            meta["type"] = QString(QLatin1Char(Protocol::PayloadImage));
+            meta["size"] = image.size();
+            QByteArray metaJson = QJsonDocument(meta).toJson(QJsonDocument::Compact);
+            for (int offset = 0, sequence = 0; offset < image.size(); offset += chunkSize, ++sequence) {
+                int length = qMin(chunkSize, static_cast<int>(image.size()) - offset);
+                peer.write(FrameEncoder::encodeChunk(peer.encoding(), static_cast<quint32>(i + 1),
+                                                     static_cast<quint32>(sequence), offset + length == image.size(),
+                                                     metaJson, QByteArray::fromRawData(image.constData() + offset, length)));
+            }
+        } else {
+#ifdef Q_OS_UNIX
+            quint32 position = 0;
+            if (!waitFor([&]() { return ring.write(image, &position); }, 5000)) {
+                ok = false;
+                break;
+            }
+            char descriptor[Protocol::SharedDescriptorSize];
+            descriptor[0] = Protocol::PayloadImage;
+            Protocol::writeUInt32BE(descriptor + 1, position);
+            Protocol::writeUInt32BE(descriptor + 5, static_cast<quint32>(image.size()));
+            peer.write(FrameEncoder::encodeBinary(Protocol::PayloadShared, peer.encoding(),
+                                                  QJsonDocument(meta).toJson(QJsonDocument::Compact),
+                                                  QByteArray(descriptor, sizeof(descriptor))));
+#endif
+        }
+        ok = waitFor([&latencies, i]() { return latencies.size() > i; }, 10000);
+    }
+
+    ClientStats stats = client.stats();
+    Percentiles latency = percentiles(latencies);
+    std::printf("  %-8s p50 %7.2f ms  p99 %7.2f ms  每张经过socket %8.1f KB  共享内存 %8.1f KB%s\n", name,
+                latency.p50, latency.p99, stats.bytesReceived / 1024.0 / screenshots,
+                stats.sharedBytes / 1024.0 / screenshots, ok ? "" : "  (超时)");
+    client.disconnectFromServer();
+}
+
+void benchScreenshots()
+{
+    std::printf("\n[截图] 4MB图片负载，三种接收方式\n");
+    runScreenshots(ScreenshotPath::Frame, "整帧");
+    runScreenshots(ScreenshotPath::Chunks, "分块");
+#ifdef Q_OS_UNIX
+    runScreenshots(ScreenshotPath::Shared, "共享内存");
+#endif
+}
+
+// ---- 界面线程 ----
+
+#ifdef Q_OS_UNIX
+// 对端线程以1000条/s推送agent_message，界面线程上的16ms定时器实际间隔超出16ms的部分即界面帧延迟
+// 对端直接写socketpair，不回复握手，客户端超时后按旧版协议工作
+template <typename Client>
+void runEventStorm(Client *client, const char *name)
+{
+    int descriptors[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors) != 0) {
+        return;
+    }
+    QObject context;
+    int received = 0;
+    client->on(QLatin1String(AgentMessage::event), [&received](const QJsonObject &message) {
+        received += message["data"].toObject()["status"].toString().isEmpty() ? 0 : 1;
+    }, &context);
+    client->connectToServer(TransportEndpoint::inherited(descriptors[1]));
+    if (!waitFor([client]() { return client->isConnected(); }, 5000)) {
+        ::close(descriptors[0]);
+        std::printf("  %-18s 连接失败\n", name);
+        return;
+    }
+
+    QJsonObject data;
+    data["conclusion"] = QString(2048, QLatin1Char('x'));
+    data["status"] = QStringLiteral("running");
+    QJsonObject message;
+    message["event"] = QLatin1String(AgentMessage::event);
+    message["data"] = data;
+    QByteArray frame;
+    FrameEncoder::encode(Protocol::PayloadJson, FrameEncoding(),
+                         QJsonDocument(message).toJson(QJsonDocument::Compact)).appendTo(&frame);
+
+    const int count = 3000;
+    std::atomic<bool> writerDone(false);
+    std::thread writer([&]() {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i) {
+            std::this_thread::sleep_until(start + std::chrono::milliseconds(i));
+            for (qint64 written = 0; written < frame.size();) {
+                ssize_t n = ::write(descriptors[0], frame.constData() + written,
+                                    static_cast<size_t>(frame.size() - written));
+                if (n <= 0) {
+                    writerDone.store(true);
+                    return;
+                }
+                written += n;
+            }
+        }
+        writerDone.store(true);
+    });
+
+    QVector<qint64> lateness;
+    QElapsedTimer clock;
+    clock.start();
+    qint64 last = 0;
+    QTimer frameTimer;
+    frameTimer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&frameTimer, &QTimer::timeout, [&]() {
+        qint64 now = clock.nsecsElapsed();
+        lateness.append(qMax<qint64>(0, now - last - 16 * 1000 * 1000));
+        last = now;
+    });
+    last = clock.nsecsElapsed();
+    frameTimer.start(16);
+    bool ok = waitFor([&]() { return writerDone.load() && received >= count; }, 20000);
+    frameTimer.stop();
+    writer.join();
+
+    Percentiles frameLag = percentiles(lateness);
+    std::printf("  %-18s 收到%5d条  帧延迟 p50 %6.2f ms  p99 %6.2f ms  最大 %6.2f ms%s\n", name, received,
+                frameLag.p50, frameLag.p99, frameLag.max, ok ? "" : "  (超时)");
+    client->disconnectFromServer();
+    waitFor([client]() { return !client->isConnected(); }, 2000);
+    ::close(descriptors[0]);
+}
+#endif
+
+void benchEventStorm()
+{
+#ifdef Q_OS_UNIX
+    std::printf("\n[界面线程] 1000条/s推送期间的界面帧延迟\n");
+    {
+        TcpClient client;
+        client.setLogLevel(TcpClient::LogLevel::Off);
+        runEventStorm(&client, "TcpClient（界面线程）");
+    }
+    {
+        ThreadedTcpClient client;
+        client.setLogLevel(TcpClient::LogLevel::Off);
+        runEventStorm(&client, "ThreadedTcpClient");
+    }
+#endif
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    benchChecksum();
+    benchCodec();
+    benchCompression();
+    benchPendingTable();
+    benchTimerWheel();
+    benchBatching();
+    benchLogging();
+    benchControlLane();
+    benchTransports();
+    benchScreenshots();
+    benchEventStorm();
+
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include "clientmetrics.h"
+#include <cmath>
+
+namespace {
+
+quint64 takeOrLoad(std::atomic<quint64> &value, bool reset)
+{
+    return reset ? value.exchange(0, std::memory_order_relaxed) : value.load(std::memory_order_relaxed);
+}
+
+int highestBit(quint64 value)
+{
+    int bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram()
+    : m_sum(0)
+    , m_max(0)
+{
+    for (std::atomic<quint64> &bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+// 小于16的值每个值一个桶；之后最高位为m的值按其下4位分到16个子桶
+int LatencyHistogram::bucketIndex(quint64 value)
+{
+    if (value < SubBucketCount) {
+        return static_cast<int>(value);
+    }
+    int magnitude = highestBit(value);
+    if (magnitude >= MaxMagnitude) {
+        return BucketCount - 1;
+    }
+    int shift = magnitude - SubBucketBits;
+    return (shift + 1) * SubBucketCount + static_cast<int>((value >> shift) & (SubBucketCount - 1));
+}
+
+quint64 LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < SubBucketCount) {
+        return static_cast<quint64>(index);
+    }
+    int shift = index / SubBucketCount - 1;
+    quint64 lower = static_cast<quint64>(SubBucketCount + index % SubBucketCount) << shift;
+    return lower + (quint64(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(qint64 microseconds)
+{
+    quint64 value = microseconds > 0 ? static_cast<quint64>(microseconds) : 0;
+    m_buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    quint64 max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+LatencySummary LatencyHistogram::summary(bool reset)
+{
+    LatencySummary summary;
+    // 各桶分别读取，数量以桶的合计为准，与百分位一致
+    quint64 counts[BucketCount];
+    quint64 total = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        counts[i] = takeOrLoad(m_buckets[i], reset);
+        total += counts[i];
+    }
+    quint64 sum = takeOrLoad(m_sum, reset);
+    quint64 max = takeOrLoad(m_max, reset);
+
+    summary.count = total;
+    if (total == 0) {
+        return summary;
+    }
+    summary.meanMs = sum / 1000.0 / total;
+    summary.maxMs = max / 1000.0;
+
+    const double percentiles[] = {0.50, 0.90, 0.99};
+    double *targets[] = {&summary.p50Ms, &summary.p90Ms, &summary.p99Ms};
+    int next = 0;
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount && next < 3; ++i) {
+        seen += counts[i];
+        while (next < 3 && seen >= static_cast<quint64>(std::ceil(percentiles[next] * total))) {
+            *targets[next] = qMin(bucketUpperBound(i), max) / 1000.0;
+            ++next;
+        }
+    }
+    return summary;
+}
+
+ClientMetrics::ClientMetrics()
+    : requestsSent(0)
+    , responsesReceived(0)
+    , timeouts(0)
+    , cancelled(0)
+    , rejected(0)
+    , dropped(0)
+    , replayed(0)
+    , reconnects(0)
+    , sharedPayloads(0)
+    , sharedBytes(0)
+    , missedPongs(0)
+    , framesSent(0)
+    , framesReceived(0)
+    , bytesSent(0)
+    , bytesReceived(0)
+    , checksumFailures(0)
+    , decompressionFailures(0)
+    , parseFailures(0)
+    , discardedBytes(0)
+    , lastReconnectMs(0)
+    , lastPayloadLatencyMs(0)
+    , pendingRequests(0)
+    , lastRttMs(0)
+    , smoothedRttMs(0)
+    , rttVarianceMs(0)
+    , peerLoopLagMs(0)
+    , m_latencyCount(0)
+{
+    for (LatencyHistogram *&histogram : m_latency) {
+        histogram = nullptr;
+    }
+}
+
+ClientMetrics::~ClientMetrics()
+{
+    for (LatencyHistogram *histogram : m_latency) {
+        delete histogram;
+    }
+}
+
+int ClientMetrics::latencyIndex(const QString &event)
+{
+    auto it = m_latencyIndex.constFind(event);
+    if (it != m_latencyIndex.constEnd()) {
+        return it.value();
+    }
+    int count = m_latencyCount.load(std::memory_order_relaxed);
+    if (count == MaxLatencyEvents) {
+        return MaxLatencyEvents - 1;
+    }
+    // 最后一个槽位收纳超出上限的事件
+    m_latencyNames[count] = count == MaxLatencyEvents - 1 ? QStringLiteral("(other)") : event;
+    m_latency[count] = new LatencyHistogram;
+    m_latencyCount.store(count + 1, std::memory_order_release);
+    if (count < MaxLatencyEvents - 1) {
+        m_latencyIndex.insert(event, count);
+    }
+    return count;
+}
+
+void ClientMetrics::recordLatency(int index, qint64 microseconds)
+{
+    if (index >= 0 && index < m_latencyCount.load(std::memory_order_relaxed)) {
+        m_latency[index]->record(microseconds);
+    }
+}
+
+ClientStats ClientMetrics::snapshot(bool reset)
+{
+    ClientStats stats;
+    stats.requestsSent = takeOrLoad(requestsSent, reset);
+    stats.responsesReceived = takeOrLoad(responsesReceived, reset);
+    stats.timeouts = takeOrLoad(timeouts, reset);
+    stats.cancelled = takeOrLoad(cancelled, reset);
+    stats.rejected = takeOrLoad(rejected, reset);
+    stats.dropped = takeOrLoad(dropped, reset);
+    stats.replayed = takeOrLoad(replayed, reset);
+    stats.reconnects = takeOrLoad(reconnects, reset);
+    stats.sharedPayloads = takeOrLoad(sharedPayloads, reset);
+    stats.sharedBytes = takeOrLoad(sharedBytes, reset);
+    stats.missedPongs = takeOrLoad(missedPongs, reset);
+    stats.framesSent = takeOrLoad(framesSent, reset);
+    stats.framesReceived = takeOrLoad(framesReceived, reset);
+    stats.bytesSent = takeOrLoad(bytesSent, reset);
+    stats.bytesReceived = takeOrLoad(bytesReceived, reset);
+    stats.checksumFailures = takeOrLoad(checksumFailures, reset);
+    stats.decompressionFailures = takeOrLoad(decompressionFailures, reset);
+    stats.parseFailures = takeOrLoad(parseFailures, reset);
+    stats.discardedBytes = takeOrLoad(discardedBytes, reset);
+
+    stats.lastReconnectMs = lastReconnectMs.load(std::memory_order_relaxed);
+    stats.lastPayloadLatencyMs = lastPayloadLatencyMs.load(std::memory_order_relaxed);
+    stats.pendingRequests = pendingRequests.load(std::memory_order_relaxed);
+    stats.lastRttMs = lastRttMs.load(std::memory_order_relaxed);
+    stats.smoothedRttMs = smoothedRttMs.load(std::memory_order_relaxed);
+    stats.rttVarianceMs = rttVarianceMs.load(std::memory_order_relaxed);
+    stats.peerLoopLagMs = peerLoopLagMs.load(std::memory_order_relaxed);
+
+    int count = m_latencyCount.load(std::memory_order_acquire);
+    stats.requestLatency.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        LatencySummary summary = m_latency[i]->summary(reset);
+        if (summary.count > 0) {
+            summary.event = m_latencyNames[i];
+            stats.requestLatency.append(summary);
+        }
+    }
+    return stats;
+}
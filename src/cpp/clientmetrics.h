@@ -0,0 +1,145 @@
+#ifndef CLIENTMETRICS_H
+#define CLIENTMETRICS_H
+
+#include <QtGlobal>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <atomic>
+
+// 一个直方图的摘要，单位毫秒
+struct LatencySummary
+{
+    QString event;
+    quint64 count = 0;
+    double meanMs = 0;
+    double p50Ms = 0;
+    double p90Ms = 0;
+    double p99Ms = 0;
+    double maxMs = 0;
+};
+
+// 客户端统计快照
+struct ClientStats
+{
+    quint64 requestsSent = 0;      // 带回调的请求数
+    quint64 responsesReceived = 0; // 按请求ID匹配到的响应数
+    quint64 timeouts = 0;          // 超时未收到响应的请求数
+    quint64 cancelled = 0;         // 调用cancel()取消的请求数
+    quint64 rejected = 0;          // 发送缓冲区已满而失败的请求数
+    quint64 dropped = 0;           // 排队后被DropOldest丢弃的请求数
+    quint64 replayed = 0;          // 重连后重新发送的请求数
+    quint64 reconnects = 0;        // 意外断开后重连成功的次数
+    qint64 lastReconnectMs = 0;    // 最近一次从断开到重连成功的耗时
+    quint64 sharedPayloads = 0;    // 通过共享内存收到的负载数
+    quint64 sharedBytes = 0;       // 通过共享内存收到的字节数，这部分不经过socket和帧解码
+    qint64 lastPayloadLatencyMs = 0; // 最近一个带sentAt的二进制负载从对端发出到处理完的耗时
+    qint64 pendingRequests = 0;    // 当前等待响应的请求数（等待表占用的位置），完成、超时和取消后减少
+    // 心跳（setHeartbeat），RTT按RFC 6298平滑，未收到过pong时为0
+    qint64 lastRttMs = 0;          // 最近一次ping到pong的往返时间
+    double smoothedRttMs = 0;      // SRTT
+    double rttVarianceMs = 0;      // RTTVAR
+    double peerLoopLagMs = 0;      // 对端上报的事件循环延迟（两次pong之间的最大值）
+    quint64 missedPongs = 0;       // 累计未按时收到的pong数
+    // 帧和字节，按写入传输层和从传输层读出计算，包括帧头和校验
+    quint64 framesSent = 0;
+    quint64 framesReceived = 0;
+    quint64 bytesSent = 0;
+    quint64 bytesReceived = 0;
+    quint64 checksumFailures = 0;      // 校验失败丢弃的帧数
+    quint64 decompressionFailures = 0; // 解压失败丢弃的帧数
+    quint64 parseFailures = 0;         // JSON、元数据或描述符解析失败的消息数
+    quint64 discardedBytes = 0;        // 数据流失步后查找同步标记时跳过的字节数
+    // 各事件从发送到收到响应的耗时，超时和出错的请求不计入
+    QVector<LatencySummary> requestLatency;
+};
+
+// 延迟直方图，按微秒记录
+// 对数线性分桶（与HdrHistogram相同的思路）：每个2的幂区间分16个子桶，相对误差不超过1/16，
+// 覆盖1微秒到约38小时，超出的值记入最后一个桶
+// 计数都是原子变量，记录只有几次relaxed原子加，可以在任意线程读取摘要
+class LatencyHistogram
+{
+public:
+    static const int SubBucketBits = 4;
+    static const int SubBucketCount = 1 << SubBucketBits;
+    static const int MaxMagnitude = 37;
+    static const int BucketCount = (MaxMagnitude - SubBucketBits + 1) * SubBucketCount;
+
+    LatencyHistogram();
+
+    void record(qint64 microseconds);
+    // reset为true时读取的同时清零，读取期间记录的值计入下一个窗口
+    LatencySummary summary(bool reset);
+
+    static int bucketIndex(quint64 value);
+    // 桶内的最大值
+    static quint64 bucketUpperBound(int index);
+
+private:
+    std::atomic<quint64> m_buckets[BucketCount];
+    std::atomic<quint64> m_sum;
+    std::atomic<quint64> m_max;
+};
+
+// 客户端的计数器和直方图
+// 计数只在网络线程（TcpClient所在线程）累加，读取和清零可以在任意线程，不加锁
+class ClientMetrics
+{
+public:
+    // 按事件名分别统计的上限，之后的事件合并到最后一个分类
+    static const int MaxLatencyEvents = 32;
+
+    ClientMetrics();
+    ~ClientMetrics();
+
+    std::atomic<quint64> requestsSent;
+    std::atomic<quint64> responsesReceived;
+    std::atomic<quint64> timeouts;
+    std::atomic<quint64> cancelled;
+    std::atomic<quint64> rejected;
+    std::atomic<quint64> dropped;
+    std::atomic<quint64> replayed;
+    std::atomic<quint64> reconnects;
+    std::atomic<quint64> sharedPayloads;
+    std::atomic<quint64> sharedBytes;
+    std::atomic<quint64> missedPongs;
+    std::atomic<quint64> framesSent;
+    std::atomic<quint64> framesReceived;
+    std::atomic<quint64> bytesSent;
+    std::atomic<quint64> bytesReceived;
+    std::atomic<quint64> checksumFailures;
+    std::atomic<quint64> decompressionFailures;
+    std::atomic<quint64> parseFailures;
+    std::atomic<quint64> discardedBytes;
+
+    // 最近的测量值，清零时保留
+    std::atomic<qint64> lastReconnectMs;
+    std::atomic<qint64> lastPayloadLatencyMs;
+    std::atomic<qint64> pendingRequests;
+    std::atomic<qint64> lastRttMs;
+    std::atomic<double> smoothedRttMs;
+    std::atomic<double> rttVarianceMs;
+    std::atomic<double> peerLoopLagMs;
+
+    static void add(std::atomic<quint64> &counter, quint64 value = 1)
+    {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // 事件名对应的直方图编号，第一次出现时创建；只能在网络线程调用
+    int latencyIndex(const QString &event);
+    void recordLatency(int index, qint64 microseconds);
+
+    // reset为true时返回本窗口的统计并开始新窗口
+    ClientStats snapshot(bool reset);
+
+private:
+    // 已创建的直方图先写入槽位，再以release发布数量，读取方按acquire读到的数量访问
+    QHash<QString, int> m_latencyIndex; // 只在网络线程访问
+    QString m_latencyNames[MaxLatencyEvents];
+    LatencyHistogram *m_latency[MaxLatencyEvents];
+    std::atomic<int> m_latencyCount;
+};
+
+#endif // CLIENTMETRICS_H
@@ -0,0 +1,171 @@
+#include "compression.h"
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// deflate压缩级别，偏向速度
+const int kDeflateLevel = 1;
+#ifdef HAVE_ZSTD
+const int kZstdLevel = 3;
+#endif
+
+#if defined(HAVE_LZ4) || defined(HAVE_ZSTD)
+// 预留[4字节原始长度]，返回压缩数据的写入位置
+char *prepareOutput(QByteArray *out, int originalLength, int bound)
+{
+    out->resize(Protocol::CompressedLengthSize + bound);
+    Protocol::writeUInt32BE(out->data(), static_cast<quint32>(originalLength));
+    return out->data() + Protocol::CompressedLengthSize;
+}
+#endif
+
+} // namespace
+
+namespace Compression {
+
+bool isAvailable(Protocol::CompressionCodec codec)
+{
+    switch (codec) {
+    case Protocol::CompressionCodec::None:
+    case Protocol::CompressionCodec::Deflate:
+        return true;
+    case Protocol::CompressionCodec::Lz4:
+#ifdef HAVE_LZ4
+        return true;
+#else
+        return false;
+#endif
+    case Protocol::CompressionCodec::Zstd:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+QList<Protocol::CompressionCodec> availableCodecs()
+{
+    QList<Protocol::CompressionCodec> codecs;
+    for (Protocol::CompressionCodec codec : {Protocol::CompressionCodec::Lz4,
+                                             Protocol::CompressionCodec::Zstd,
+                                             Protocol::CompressionCodec::Deflate}) {
+        if (isAvailable(codec)) {
+            codecs.append(codec);
+        }
+    }
+    return codecs;
+}
+
+QString codecName(Protocol::CompressionCodec codec)
+{
+    switch (codec) {
+    case Protocol::CompressionCodec::Deflate:
+        return QStringLiteral("deflate");
+    case Protocol::CompressionCodec::Lz4:
+        return QStringLiteral("lz4");
+    case Protocol::CompressionCodec::Zstd:
+        return QStringLiteral("zstd");
+    case Protocol::CompressionCodec::None:
+        break;
+    }
+    return QStringLiteral("none");
+}
+
+bool codecFromName(const QString &name, Protocol::CompressionCodec *codec)
+{
+    for (Protocol::CompressionCodec candidate : {Protocol::CompressionCodec::None,
+                                                 Protocol::CompressionCodec::Deflate,
+                                                 Protocol::CompressionCodec::Lz4,
+                                                 Protocol::CompressionCodec::Zstd}) {
+        if (name == codecName(candidate)) {
+            *codec = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool compress(Protocol::CompressionCodec codec, const char *data, int length, QByteArray *out)
+{
+    switch (codec) {
+    case Protocol::CompressionCodec::Deflate:
+        // qCompress的输出本身就是[4字节原始长度][zlib数据]
+        *out = qCompress(reinterpret_cast<const uchar *>(data), length, kDeflateLevel);
+        return !out->isEmpty();
+#ifdef HAVE_LZ4
+    case Protocol::CompressionCodec::Lz4: {
+        char *dst = prepareOutput(out, length, LZ4_compressBound(length));
+        int written = LZ4_compress_default(data, dst, length, out->size() - Protocol::CompressedLengthSize);
+        if (written <= 0) {
+            return false;
+        }
+        out->resize(Protocol::CompressedLengthSize + written);
+        return true;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case Protocol::CompressionCodec::Zstd: {
+        size_t bound = ZSTD_compressBound(static_cast<size_t>(length));
+        char *dst = prepareOutput(out, length, static_cast<int>(bound));
+        size_t written = ZSTD_compress(dst, bound, data, static_cast<size_t>(length), kZstdLevel);
+        if (ZSTD_isError(written)) {
+            return false;
+        }
+        out->resize(Protocol::CompressedLengthSize + static_cast<int>(written));
+        return true;
+    }
+#endif
+    default:
+        break;
+    }
+    return false;
+}
+
+bool decompress(Protocol::CompressionCodec codec, const char *data, int length,
+                int maxLength, QByteArray *out)
+{
+    if (length < Protocol::CompressedLengthSize) {
+        return false;
+    }
+    quint32 originalLength = Protocol::readUInt32BE(data);
+    if (originalLength > static_cast<quint32>(maxLength)) {
+        return false;
+    }
+    const char *src = data + Protocol::CompressedLengthSize;
+    int srcLength = length - Protocol::CompressedLengthSize;
+
+    switch (codec) {
+    case Protocol::CompressionCodec::Deflate:
+        *out = qUncompress(reinterpret_cast<const uchar *>(data), length);
+        return static_cast<quint32>(out->size()) == originalLength;
+#ifdef HAVE_LZ4
+    case Protocol::CompressionCodec::Lz4: {
+        out->resize(static_cast<int>(originalLength));
+        int written = LZ4_decompress_safe(src, out->data(), srcLength, out->size());
+        return written >= 0 && static_cast<quint32>(written) == originalLength;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case Protocol::CompressionCodec::Zstd: {
+        out->resize(static_cast<int>(originalLength));
+        size_t written = ZSTD_decompress(out->data(), originalLength, src, static_cast<size_t>(srcLength));
+        return !ZSTD_isError(written) && written == originalLength;
+    }
+#endif
+    default:
+        break;
+    }
+    Q_UNUSED(src);
+    Q_UNUSED(srcLength);
+    return false;
+}
+
+} // namespace Compression
@@ -0,0 +1,29 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include "protocol.h"
+
+// 帧负载压缩
+// 压缩结果格式：[4字节原始长度][压缩数据]，与qCompress的输出一致
+// Deflate使用Qt自带的zlib；LZ4/zstd在编译时找到对应库（HAVE_LZ4/HAVE_ZSTD）才可用
+namespace Compression {
+
+bool isAvailable(Protocol::CompressionCodec codec);
+// 本端可用的压缩算法，按压缩速度从快到慢排列，不含None
+QList<Protocol::CompressionCodec> availableCodecs();
+
+QString codecName(Protocol::CompressionCodec codec);
+bool codecFromName(const QString &name, Protocol::CompressionCodec *codec);
+
+// 压缩data[0, length)，结果写入out
+bool compress(Protocol::CompressionCodec codec, const char *data, int length, QByteArray *out);
+// 解压到out，out的已有容量会被复用；原始长度超过maxLength时视为错误
+bool decompress(Protocol::CompressionCodec codec, const char *data, int length,
+                int maxLength, QByteArray *out);
+
+} // namespace Compression
+
+#endif // COMPRESSION_H
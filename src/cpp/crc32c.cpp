@@ -0,0 +1,174 @@
+#include "crc32c.h"
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <nmmintrin.h>
+#define CRC32C_X86_MSVC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <nmmintrin.h>
+#define CRC32C_X86_GNU 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_ARM 1
+#endif
+
+namespace {
+
+// 反射多项式
+const quint32 kPolynomial = 0x82F63B78u;
+
+// slice-by-8查找表，首次使用时生成
+struct SliceTables
+{
+    quint32 table[8][256];
+
+    SliceTables()
+    {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ kPolynomial : crc >> 1;
+            }
+            table[0][i] = crc;
+        }
+        for (quint32 i = 0; i < 256; ++i) {
+            for (int slice = 1; slice < 8; ++slice) {
+                quint32 prev = table[slice - 1][i];
+                table[slice][i] = (prev >> 8) ^ table[0][prev & 0xFF];
+            }
+        }
+    }
+};
+
+const SliceTables &sliceTables()
+{
+    static const SliceTables tables;
+    return tables;
+}
+
+inline quint32 loadLE32(const quint8 *p)
+{
+    return quint32(p[0]) | (quint32(p[1]) << 8) | (quint32(p[2]) << 16) | (quint32(p[3]) << 24);
+}
+
+quint32 extendPortable(quint32 crc, const quint8 *p, size_t length)
+{
+    const SliceTables &t = sliceTables();
+
+    while (length >= 8) {
+        quint32 lo = loadLE32(p) ^ crc;
+        quint32 hi = loadLE32(p + 4);
+        crc = t.table[7][lo & 0xFF] ^
+              t.table[6][(lo >> 8) & 0xFF] ^
+              t.table[5][(lo >> 16) & 0xFF] ^
+              t.table[4][lo >> 24] ^
+              t.table[3][hi & 0xFF] ^
+              t.table[2][(hi >> 8) & 0xFF] ^
+              t.table[1][(hi >> 16) & 0xFF] ^
+              t.table[0][hi >> 24];
+        p += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc = (crc >> 8) ^ t.table[0][(crc ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(CRC32C_X86_GNU) || defined(CRC32C_X86_MSVC)
+
+#if defined(CRC32C_X86_GNU)
+__attribute__((target("sse4.2")))
+#endif
+quint32 extendSse42(quint32 crc, const quint8 *p, size_t length)
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    quint64 crc64 = crc;
+    while (length >= 8) {
+        quint64 word;
+        memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        length -= 8;
+    }
+    crc = static_cast<quint32>(crc64);
+#endif
+    while (length >= 4) {
+        quint32 word;
+        memcpy(&word, p, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+        p += 4;
+        length -= 4;
+    }
+    while (length--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+bool cpuHasSse42()
+{
+#if defined(CRC32C_X86_GNU)
+    return __builtin_cpu_supports("sse4.2");
+#else
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#endif
+}
+
+#elif defined(CRC32C_ARM)
+
+quint32 extendArm(quint32 crc, const quint8 *p, size_t length)
+{
+    while (length >= 8) {
+        quint64 word;
+        memcpy(&word, p, sizeof(word));
+        crc = __crc32cd(crc, word);
+        p += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+
+#endif
+
+using ExtendFunction = quint32 (*)(quint32, const quint8 *, size_t);
+
+ExtendFunction selectImplementation()
+{
+#if defined(CRC32C_X86_GNU) || defined(CRC32C_X86_MSVC)
+    if (cpuHasSse42()) {
+        return extendSse42;
+    }
+#elif defined(CRC32C_ARM)
+    return extendArm;
+#endif
+    return extendPortable;
+}
+
+ExtendFunction implementation()
+{
+    static const ExtendFunction function = selectImplementation();
+    return function;
+}
+
+} // namespace
+
+namespace Crc32c {
+
+quint32 extend(quint32 crc, const void *data, size_t length)
+{
+    return ~implementation()(~crc, static_cast<const quint8 *>(data), length);
+}
+
+bool isHardwareAccelerated()
+{
+    return implementation() != extendPortable;
+}
+
+} // namespace Crc32c
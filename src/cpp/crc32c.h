@@ -0,0 +1,23 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <QtGlobal>
+
+// CRC32C（Castagnoli，多项式0x1EDC6F41）
+// 运行时检测CPU：x86使用SSE4.2 crc32指令，ARMv8使用CRC扩展，其余平台回退到slice-by-8查表
+namespace Crc32c {
+
+// 计算data[0, length)的CRC32C，crc为上一段的结果，可用于分段累加
+quint32 extend(quint32 crc, const void *data, size_t length);
+
+inline quint32 compute(const void *data, size_t length)
+{
+    return extend(0, data, length);
+}
+
+// 当前进程是否使用了硬件加速路径
+bool isHardwareAccelerated();
+
+} // namespace Crc32c
+
+#endif // CRC32C_H
@@ -0,0 +1,415 @@
+#include "framecodec.h"
+#include "compression.h"
+#include <cstring>
+
+namespace {
+
+// 初始缓冲区大小
+const int kInitialBufferSize = 64 * 1024;
+// 缓冲区清空后超过该大小则释放，避免一次大帧长期占用内存
+const int kShrinkThreshold = 4 * 1024 * 1024;
+// 单次从设备读取的上限
+const qint64 kMaxReadChunk = 16 * 1024 * 1024;
+// 负载上限针对数据本身，线上长度另外允许元数据、分块头和压缩头的余量
+const quint32 kPayloadHeadroom = 64 * 1024;
+
+const char kSyncMarker[Protocol::SyncMarkerSize] = {
+    static_cast<char>(Protocol::SyncMarker0), static_cast<char>(Protocol::SyncMarker1)
+};
+
+} // namespace
+
+char EncodedFrame::byteAt(qint64 index) const
+{
+    if (index < Protocol::HeaderSize) {
+        return header[index];
+    }
+    index -= Protocol::HeaderSize;
+    if (index < prefix.size()) {
+        return prefix.at(static_cast<int>(index));
+    }
+    index -= prefix.size();
+    if (index < payload.size()) {
+        return payload.at(static_cast<int>(index));
+    }
+    return trailer[index - payload.size()];
+}
+
+qint64 EncodedFrame::writeTo(QIODevice *device, bool syncMarker) const
+{
+    if (syncMarker && device->write(kSyncMarker, Protocol::SyncMarkerSize) != Protocol::SyncMarkerSize) {
+        return -1;
+    }
+    if (device->write(header, Protocol::HeaderSize) != Protocol::HeaderSize) {
+        return -1;
+    }
+    if (!prefix.isEmpty() && device->write(prefix) != prefix.size()) {
+        return -1;
+    }
+    if (!payload.isEmpty() && device->write(payload) != payload.size()) {
+        return -1;
+    }
+    if (device->write(trailer, Protocol::ChecksumFieldSize) != Protocol::ChecksumFieldSize) {
+        return -1;
+    }
+    return size() + (syncMarker ? Protocol::SyncMarkerSize : 0);
+}
+
+void EncodedFrame::appendTo(QByteArray *buffer, bool syncMarker) const
+{
+    buffer->reserve(buffer->size() + static_cast<int>(size()) + Protocol::SyncMarkerSize);
+    if (syncMarker) {
+        buffer->append(kSyncMarker, Protocol::SyncMarkerSize);
+    }
+    buffer->append(header, Protocol::HeaderSize);
+    buffer->append(prefix);
+    buffer->append(payload);
+    buffer->append(trailer, Protocol::ChecksumFieldSize);
+}
+
+EncodedFrame FrameEncoder::encode(char payloadType, const FrameEncoding &encoding, const QByteArray &payload)
+{
+    EncodedFrame frame;
+    frame.payload = payload;
+    return finish(frame, payloadType, encoding);
+}
+
+EncodedFrame FrameEncoder::encodeBinary(char payloadType, const FrameEncoding &encoding,
+                                        const QByteArray &meta, const QByteArray &data)
+{
+    EncodedFrame frame;
+    frame.prefix.resize(Protocol::BinaryMetaLengthSize + meta.size());
+    Protocol::writeUInt32BE(frame.prefix.data(), static_cast<quint32>(meta.size()));
+    memcpy(frame.prefix.data() + Protocol::BinaryMetaLengthSize, meta.constData(), static_cast<size_t>(meta.size()));
+    frame.payload = data;
+    return finish(frame, payloadType, encoding);
+}
+
+EncodedFrame FrameEncoder::encodeBatch(const FrameEncoding &encoding, const QList<QByteArray> &messages)
+{
+    int total = 0;
+    for (const QByteArray &message : messages) {
+        total += Protocol::BatchItemLengthSize + static_cast<int>(message.size());
+    }
+
+    EncodedFrame frame;
+    frame.payload.resize(total);
+    char *p = frame.payload.data();
+    for (const QByteArray &message : messages) {
+        Protocol::writeUInt32BE(p, static_cast<quint32>(message.size()));
+        memcpy(p + Protocol::BatchItemLengthSize, message.constData(), static_cast<size_t>(message.size()));
+        p += Protocol::BatchItemLengthSize + message.size();
+    }
+    return finish(frame, Protocol::PayloadBatch, encoding);
+}
+
+EncodedFrame FrameEncoder::encodeChunk(const FrameEncoding &encoding, quint32 streamId, quint32 sequence,
+                                       bool final, const QByteArray &meta, const QByteArray &data)
+{
+    EncodedFrame frame;
+    int metaSize = sequence == 0 ? Protocol::BinaryMetaLengthSize + meta.size() : 0;
+    frame.prefix.resize(Protocol::ChunkHeaderSize + metaSize);
+    char *p = frame.prefix.data();
+    Protocol::writeUInt32BE(p, streamId);
+    Protocol::writeUInt32BE(p + 4, sequence);
+    p[8] = static_cast<char>(final ? Protocol::ChunkFinal : 0);
+    if (metaSize > 0) {
+        p += Protocol::ChunkHeaderSize;
+        Protocol::writeUInt32BE(p, static_cast<quint32>(meta.size()));
+        memcpy(p + Protocol::BinaryMetaLengthSize, meta.constData(), static_cast<size_t>(meta.size()));
+    }
+    frame.payload = data;
+    return finish(frame, Protocol::PayloadChunk, encoding);
+}
+
+EncodedFrame FrameEncoder::finish(EncodedFrame frame, char payloadType, const FrameEncoding &encoding)
+{
+    // 超过阈值的负载整体压缩，压缩后没有变小则按原样发送
+    Protocol::CompressionCodec codec = Protocol::CompressionCodec::None;
+    if (encoding.compression != Protocol::CompressionCodec::None
+        && frame.payloadSize() >= encoding.compressionThreshold) {
+        QByteArray raw = frame.prefix.isEmpty() ? frame.payload : frame.prefix + frame.payload;
+        QByteArray compressed;
+        if (Compression::compress(encoding.compression, raw.constData(), raw.size(), &compressed)
+            && compressed.size() < raw.size()) {
+            frame.prefix.clear();
+            frame.payload = compressed;
+            codec = encoding.compression;
+        }
+    }
+
+    // [4字节长度][2字节类型]，长度只计算负载
+    Protocol::writeUInt32BE(frame.header, static_cast<quint32>(frame.payloadSize()));
+    char *typeField = frame.header + Protocol::LengthFieldSize;
+    typeField[0] = payloadType;
+    typeField[1] = static_cast<char>(Protocol::makeFlags(encoding.checksum, codec));
+
+    Protocol::ChecksumBuilder checksum(encoding.checksum);
+    checksum.addData(typeField, Protocol::TypeFieldSize);
+    checksum.addData(frame.prefix.constData(), frame.prefix.size());
+    checksum.addData(frame.payload.constData(), frame.payload.size());
+    Protocol::writeUInt32BE(frame.trailer, checksum.result());
+    return frame;
+}
+
+bool splitBinaryPayload(const FrameView &frame, BinaryPayloadView *view)
+{
+    if (frame.payloadLength < Protocol::BinaryMetaLengthSize) {
+        return false;
+    }
+    quint32 metaLength = Protocol::readUInt32BE(frame.payload);
+    if (metaLength > static_cast<quint32>(frame.payloadLength - Protocol::BinaryMetaLengthSize)) {
+        return false;
+    }
+
+    const char *meta = frame.payload + Protocol::BinaryMetaLengthSize;
+    int dataLength = frame.payloadLength - Protocol::BinaryMetaLengthSize - static_cast<int>(metaLength);
+    view->meta = QByteArray::fromRawData(meta, static_cast<int>(metaLength));
+    view->data = QByteArray::fromRawData(meta + metaLength, dataLength);
+    return true;
+}
+
+bool splitBatchPayload(const FrameView &frame, QList<QByteArray> *messages)
+{
+    messages->clear();
+    const char *p = frame.payload;
+    int remaining = frame.payloadLength;
+    while (remaining > 0) {
+        if (remaining < Protocol::BatchItemLengthSize) {
+            return false;
+        }
+        quint32 length = Protocol::readUInt32BE(p);
+        if (length > static_cast<quint32>(remaining - Protocol::BatchItemLengthSize)) {
+            return false;
+        }
+        messages->append(QByteArray::fromRawData(p + Protocol::BatchItemLengthSize, static_cast<int>(length)));
+        p += Protocol::BatchItemLengthSize + length;
+        remaining -= Protocol::BatchItemLengthSize + static_cast<int>(length);
+    }
+    return true;
+}
+
+bool splitChunkPayload(const FrameView &frame, ChunkView *view)
+{
+    if (frame.payloadLength < Protocol::ChunkHeaderSize) {
+        return false;
+    }
+    const char *p = frame.payload;
+    view->streamId = Protocol::readUInt32BE(p);
+    view->sequence = Protocol::readUInt32BE(p + 4);
+    view->final = static_cast<quint8>(p[8]) & Protocol::ChunkFinal;
+
+    const char *data = p + Protocol::ChunkHeaderSize;
+    int dataLength = frame.payloadLength - Protocol::ChunkHeaderSize;
+    view->meta.clear();
+    if (view->sequence == 0) {
+        if (dataLength < Protocol::BinaryMetaLengthSize) {
+            return false;
+        }
+        quint32 metaLength = Protocol::readUInt32BE(data);
+        if (metaLength > static_cast<quint32>(dataLength - Protocol::BinaryMetaLengthSize)) {
+            return false;
+        }
+        view->meta = QByteArray::fromRawData(data + Protocol::BinaryMetaLengthSize, static_cast<int>(metaLength));
+        data += Protocol::BinaryMetaLengthSize + metaLength;
+        dataLength -= Protocol::BinaryMetaLengthSize + static_cast<int>(metaLength);
+    }
+    view->data = QByteArray::fromRawData(data, dataLength);
+    return true;
+}
+
+FrameDecoder::FrameDecoder()
+    : m_readPos(0)
+    , m_writePos(0)
+    , m_maxPayloadSize(Protocol::DefaultMaxPayloadSize)
+    , m_synced(false)
+    , m_broken(false)
+    , m_discardedBytes(0)
+{
+}
+
+char *FrameDecoder::reserve(int length)
+{
+    int required = m_writePos + length;
+    if (required > m_buffer.size()) {
+        int newSize = qMax(kInitialBufferSize, m_buffer.size());
+        while (newSize < required) {
+            newSize *= 2;
+        }
+        m_buffer.resize(newSize);
+    }
+    return m_buffer.data() + m_writePos;
+}
+
+qint64 FrameDecoder::readFrom(QIODevice *device)
+{
+    qint64 total = 0;
+    qint64 available;
+    while ((available = device->bytesAvailable()) > 0) {
+        int chunk = static_cast<int>(qMin(available, kMaxReadChunk));
+        qint64 bytesRead = device->read(reserve(chunk), chunk);
+        if (bytesRead <= 0) {
+            break;
+        }
+        m_writePos += static_cast<int>(bytesRead);
+        total += bytesRead;
+    }
+    return total;
+}
+
+void FrameDecoder::append(const char *data, int length)
+{
+    if (length <= 0) {
+        return;
+    }
+    memcpy(reserve(length), data, static_cast<size_t>(length));
+    m_writePos += length;
+}
+
+bool FrameDecoder::nextFrame(FrameView *frame)
+{
+    const char *start = nullptr;
+    int markerSize = 0;
+    quint32 payloadLength = 0;
+    quint64 frameLength = 0;
+    for (;;) {
+        if (m_broken) {
+            return false;
+        }
+        int available = bufferedBytes();
+        if (available <= 0) {
+            return false;
+        }
+        start = m_buffer.constData() + m_readPos;
+        markerSize = 0;
+        if (static_cast<quint8>(start[0]) == Protocol::SyncMarker0) {
+            if (available < Protocol::SyncMarkerSize) {
+                return false;
+            }
+            if (static_cast<quint8>(start[1]) != Protocol::SyncMarker1) {
+                resync();
+                continue;
+            }
+            markerSize = Protocol::SyncMarkerSize;
+            m_synced = true;
+        } else if (m_synced) {
+            resync();
+            continue;
+        }
+
+        if (available < markerSize + Protocol::HeaderSize) {
+            return false;
+        }
+        payloadLength = Protocol::readUInt32BE(start + markerSize);
+        quint8 flags = static_cast<quint8>(start[markerSize + Protocol::LengthFieldSize + 1]);
+        bool oversized = payloadLength > static_cast<quint32>(m_maxPayloadSize) + kPayloadHeadroom;
+        if (markerSize > 0 && (oversized || !Protocol::isWellFormedFlags(flags))) {
+            // 长度异常或标志位不合法，这里的标记是数据中偶然出现的字节
+            resync();
+            continue;
+        }
+        if (oversized) {
+            m_broken = true;
+            return false;
+        }
+
+        frameLength = static_cast<quint64>(markerSize + Protocol::FrameOverhead) + payloadLength;
+        if (static_cast<quint64>(available) < frameLength) {
+            return false;
+        }
+        break;
+    }
+
+    // 校验覆盖[2字节类型][负载]
+    const char *body = start + markerSize + Protocol::LengthFieldSize;
+    int bodyLength = Protocol::TypeFieldSize + static_cast<int>(payloadLength);
+
+    frame->payloadType = body[0];
+    frame->flags = static_cast<quint8>(body[1]);
+    frame->payload = body + Protocol::TypeFieldSize;
+    frame->payloadLength = static_cast<int>(payloadLength);
+    frame->wireLength = frame->payloadLength;
+    frame->compression = Protocol::CompressionCodec::None;
+    frame->decompressionFailed = false;
+    frame->receivedChecksum = Protocol::readUInt32BE(body + bodyLength);
+
+    // 校验模式由对端在标志位中声明
+    if (Protocol::isKnownChecksumMode(frame->flags)) {
+        frame->calculatedChecksum = Protocol::checksum(Protocol::checksumModeFromFlags(frame->flags),
+                                                       body, bodyLength);
+        frame->checksumValid = frame->calculatedChecksum == frame->receivedChecksum;
+    } else {
+        frame->calculatedChecksum = ~frame->receivedChecksum;
+        frame->checksumValid = false;
+    }
+
+    // 带标记的帧校验失败时长度字段本身可能有误：按长度跳过后紧跟同步标记（或暂无后续数据）才整帧跳过，
+    // 否则只跳过标记，下一次从这里重新查找
+    if (!frame->checksumValid && markerSize > 0) {
+        int next = m_readPos + static_cast<int>(frameLength);
+        if (next < m_writePos && static_cast<quint8>(m_buffer.at(next)) != Protocol::SyncMarker0) {
+            frameLength = markerSize;
+        }
+    }
+    m_readPos += static_cast<int>(frameLength);
+
+    // 校验通过后解压，校验覆盖的是压缩后的数据
+    Protocol::CompressionCodec codec = Protocol::compressionFromFlags(frame->flags);
+    if (frame->checksumValid && codec != Protocol::CompressionCodec::None) {
+        frame->compression = codec;
+        if (Compression::decompress(codec, frame->payload, frame->payloadLength, m_maxPayloadSize, &m_inflated)) {
+            frame->payload = m_inflated.constData();
+            frame->payloadLength = m_inflated.size();
+        } else {
+            frame->decompressionFailed = true;
+        }
+    }
+    return true;
+}
+
+// 从当前位置之后查找下一个同步标记的首字节，memchr按机器字或SIMD宽度扫描，一次扫完整个缓冲区；
+// 找不到时丢弃全部已缓冲的数据
+void FrameDecoder::resync()
+{
+    const char *begin = m_buffer.constData() + m_readPos;
+    int available = bufferedBytes();
+    const void *found = memchr(begin + 1, Protocol::SyncMarker0, static_cast<size_t>(available - 1));
+    int skipped = found ? static_cast<int>(static_cast<const char *>(found) - begin) : available;
+    m_readPos += skipped;
+    m_discardedBytes += skipped;
+}
+
+qint64 FrameDecoder::takeDiscardedBytes()
+{
+    qint64 discarded = m_discardedBytes;
+    m_discardedBytes = 0;
+    return discarded;
+}
+
+void FrameDecoder::compact()
+{
+    if (m_readPos == 0) {
+        return;
+    }
+
+    int remaining = bufferedBytes();
+    if (remaining > 0) {
+        memmove(m_buffer.data(), m_buffer.constData() + m_readPos, static_cast<size_t>(remaining));
+    } else if (m_buffer.size() > kShrinkThreshold) {
+        m_buffer.clear();
+    }
+    m_readPos = 0;
+    m_writePos = remaining;
+}
+
+void FrameDecoder::clear()
+{
+    m_readPos = 0;
+    m_writePos = 0;
+    m_synced = false;
+    m_broken = false;
+    m_discardedBytes = 0;
+    if (m_buffer.size() > kShrinkThreshold) {
+        m_buffer.clear();
+    }
+}
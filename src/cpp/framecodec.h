@@ -0,0 +1,162 @@
+#ifndef FRAMECODEC_H
+#define FRAMECODEC_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include "protocol.h"
+
+// 解码出的一帧，payload指向FrameDecoder内部缓冲区
+// 只在下一次compact()/clear()之前有效，需要保留时自行拷贝
+struct FrameView
+{
+    char payloadType = 0;
+    quint8 flags = 0;
+    const char *payload = nullptr;
+    int payloadLength = 0;
+    quint32 receivedChecksum = 0;
+    quint32 calculatedChecksum = 0;
+    bool checksumValid = false;
+    // 压缩帧：payload指向解压后的数据，wireLength为线上的负载长度
+    Protocol::CompressionCodec compression = Protocol::CompressionCodec::None;
+    int wireLength = 0;
+    bool decompressionFailed = false;
+
+    // 零拷贝包装，生命周期同payload
+    QByteArray payloadBytes() const
+    {
+        return QByteArray::fromRawData(payload, payloadLength);
+    }
+};
+
+// 编码后的一帧
+// 头部和校验尾部内联保存，负载与调用方隐式共享，编码过程不拷贝负载；
+// 发送时分段写入socket，负载只在进入socket写缓冲区时拷贝一次
+// 二进制帧的负载由prefix（元数据长度+元数据）和payload（二进制数据）两段组成
+struct EncodedFrame
+{
+    char header[Protocol::HeaderSize];
+    char trailer[Protocol::ChecksumFieldSize];
+    QByteArray prefix;
+    QByteArray payload;
+
+    qint64 payloadSize() const { return prefix.size() + payload.size(); }
+    qint64 size() const { return Protocol::FrameOverhead + payloadSize(); }
+    // 按整帧偏移取字节，用于调试输出
+    char byteAt(qint64 index) const;
+    quint32 checksum() const { return Protocol::readUInt32BE(trailer); }
+    Protocol::CompressionCodec compression() const
+    {
+        return Protocol::compressionFromFlags(static_cast<quint8>(header[Protocol::LengthFieldSize + 1]));
+    }
+
+    // 聚合写入，返回写入的字节数，失败返回-1；syncMarker为true时先写同步标记
+    qint64 writeTo(QIODevice *device, bool syncMarker = false) const;
+    // 追加到合并写缓冲区
+    void appendTo(QByteArray *buffer, bool syncMarker = false) const;
+};
+
+// 发送端的编码参数，由连接协商结果决定
+struct FrameEncoding
+{
+    Protocol::ChecksumMode checksum = Protocol::ChecksumMode::Sha256;
+    Protocol::CompressionCodec compression = Protocol::CompressionCodec::None;
+    // 负载达到该大小才压缩，压缩后没有变小则按原样发送
+    int compressionThreshold = 4096;
+    // 写入时在帧前加同步标记（协议版本2）；标记不在校验范围内，由写入时的设置决定，与编码结果无关
+    bool syncMarker = false;
+};
+
+class FrameEncoder
+{
+public:
+    static EncodedFrame encode(char payloadType, const FrameEncoding &encoding, const QByteArray &payload);
+    // 二进制帧：[4字节元数据长度][元数据][二进制数据]
+    static EncodedFrame encodeBinary(char payloadType, const FrameEncoding &encoding,
+                                     const QByteArray &meta, const QByteArray &data);
+    // 批量帧，每条消息前加4字节长度
+    static EncodedFrame encodeBatch(const FrameEncoding &encoding, const QList<QByteArray> &messages);
+    // 分块帧，meta只在序号0的分块中携带，data与调用方共享
+    static EncodedFrame encodeChunk(const FrameEncoding &encoding, quint32 streamId, quint32 sequence,
+                                    bool final, const QByteArray &meta, const QByteArray &data);
+
+private:
+    static EncodedFrame finish(EncodedFrame frame, char payloadType, const FrameEncoding &encoding);
+};
+
+// 二进制帧负载的解析结果，指向FrameView的负载
+struct BinaryPayloadView
+{
+    QByteArray meta;
+    QByteArray data;
+};
+
+// 拆分二进制帧负载，格式错误返回false
+bool splitBinaryPayload(const FrameView &frame, BinaryPayloadView *view);
+
+// 拆分批量帧负载，消息指向FrameView的负载，格式错误返回false
+bool splitBatchPayload(const FrameView &frame, QList<QByteArray> *messages);
+
+// 分块帧负载的解析结果，meta只在序号0的分块中存在
+struct ChunkView
+{
+    quint32 streamId = 0;
+    quint32 sequence = 0;
+    bool final = false;
+    QByteArray meta;
+    QByteArray data;
+};
+
+// 拆分分块帧负载，格式错误返回false
+bool splitChunkPayload(const FrameView &frame, ChunkView *view);
+
+// 帧解码器
+// 数据直接读入一块连续缓冲区，按读偏移逐帧解析，不移动剩余数据；
+// 调用方在一批数据处理完后调用一次compact()，把未完成的半帧挪到缓冲区头部
+// 长度超过上限的帧不等待其数据：带同步标记时跳到下一个标记重新分帧，旧版帧无法定位下一帧，数据流视为损坏；
+// 因此缓冲区最多保存一个上限大小的半帧，不会因错误的长度字段无限增长
+class FrameDecoder
+{
+public:
+    FrameDecoder();
+
+    // 从设备读取全部可用数据，返回读取的字节数
+    qint64 readFrom(QIODevice *device);
+    // 追加已在内存中的数据
+    void append(const char *data, int length);
+
+    // 取出下一帧，数据不完整或数据流已损坏时返回false
+    // 压缩帧解压到内部的复用缓冲区，frame.payload只在下一次nextFrame()之前有效
+    // 收到过带同步标记的帧后，校验失败的帧在其后紧跟同步标记时整帧跳过，否则从标记之后重新查找
+    bool nextFrame(FrameView *frame);
+
+    // 单帧负载的上限，线上长度和解压后的长度超过上限都视为错误帧
+    void setMaxPayloadSize(int bytes) { m_maxPayloadSize = bytes; }
+    int maxPayloadSize() const { return m_maxPayloadSize; }
+
+    // 旧版帧的长度超过上限，无法再定位帧边界，只能断开连接
+    bool isBroken() const { return m_broken; }
+    // 上次调用以来重新同步时跳过的字节数
+    qint64 takeDiscardedBytes();
+
+    // 丢弃已解析的数据，每批数据最多移动一次
+    void compact();
+    void clear();
+
+    int bufferedBytes() const { return m_writePos - m_readPos; }
+
+private:
+    char *reserve(int length);
+    void resync();
+
+    QByteArray m_buffer;
+    int m_readPos;
+    int m_writePos;
+    QByteArray m_inflated;
+    int m_maxPayloadSize;
+    bool m_synced; // 收到过带同步标记的帧，此后不带标记的位置都视为失步
+    bool m_broken;
+    qint64 m_discardedBytes;
+};
+
+#endif // FRAMECODEC_H
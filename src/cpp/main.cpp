@@ -111,6 +111,13 @@ int main(int argc, char *argv[])
     
     // 创建并显示主窗口
     MainWindow mainWindow;
+    // 内嵌的Node通过socketpair或本地套接字连接，不占用TCP端口
+    if (serverStarted) {
+        TransportEndpoint endpoint = g_embeddedNodeRunner->takeClientEndpoint();
+        if (endpoint.kind != TransportEndpoint::Kind::Tcp) {
+            mainWindow.setServerEndpoint(endpoint);
+        }
+    }
     mainWindow.show();
     
     std::cout << "[System] Qt application started, showing main window..." << std::endl;
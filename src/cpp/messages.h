@@ -0,0 +1,52 @@
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include "messageschema.h"
+
+// 与Node端（message.ts、tcp-server.ts）约定的事件和data字段
+// 新增或修改字段只改这里，编码和解码随字段列表一起生成
+
+// ---- 客户端发出的请求 ----
+
+// 计算请求；operation缺省时按加法处理
+#define CALCULATE_FIELDS(X) \
+    X(int, a)               \
+    X(int, b)               \
+    X(QString, operation)
+SCHEMA_MESSAGE(CalculateRequest, "calculate", CALCULATE_FIELDS)
+
+// 让Agent执行一条指令，type为Agent类型（browser、computer）；执行结束时对端回复command_finished，请求被取消时不回复
+#define EXECUTE_COMMAND_FIELDS(X) \
+    X(QString, command)           \
+    X(QString, type)
+SCHEMA_MESSAGE(ExecuteCommand, "execute_command", EXECUTE_COMMAND_FIELDS)
+
+// 以下请求没有data字段，对端以同一个requestId回复
+#define NO_FIELDS(X)
+SCHEMA_MESSAGE(NodeDetect, "node_detect", NO_FIELDS) // 回复heartbeat
+// 停止、暂停、恢复是控制消息，不排在正在发送的大块数据后面
+SCHEMA_CONTROL_MESSAGE(StopAgent, "stop_agent", NO_FIELDS)     // 回复agent_stopped
+SCHEMA_CONTROL_MESSAGE(PauseAgent, "pause_agent", NO_FIELDS)   // 回复agent_paused
+SCHEMA_CONTROL_MESSAGE(ResumeAgent, "resume_agent", NO_FIELDS) // 回复agent_resumed
+
+// ---- 服务器推送的事件 ----
+
+SCHEMA_MESSAGE(ThoughtStart, "thought-start", NO_FIELDS)
+SCHEMA_MESSAGE(ThoughtEnd, "thought-end", NO_FIELDS)
+
+// Agent的执行结果，status为running或end，conclusion可能为null
+#define AGENT_RESULT_FIELDS(X) \
+    X(QString, conclusion)     \
+    X(QString, status)
+SCHEMA_STRUCT(AgentResult, AGENT_RESULT_FIELDS)
+
+// conversations等字段不在schema中，需要时按事件名订阅，从完整消息中读取
+#define AGENT_MESSAGE_FIELDS(X) \
+    X(AgentResult, data)
+SCHEMA_MESSAGE(AgentMessage, "agent_message", AGENT_MESSAGE_FIELDS)
+
+#define AGENT_ERROR_FIELDS(X) \
+    X(QString, message)
+SCHEMA_MESSAGE(AgentError, "agent_error", AGENT_ERROR_FIELDS)
+
+#endif // MESSAGES_H
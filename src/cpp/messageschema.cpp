@@ -0,0 +1,77 @@
+#include "messageschema.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <cmath>
+
+namespace Schema {
+
+void writeString(QByteArray *out, const QString &value)
+{
+    static const char kHex[] = "0123456789abcdef";
+    QByteArray utf8 = value.toUtf8();
+    out->reserve(out->size() + utf8.size() + 2);
+    out->append('"');
+    // 没有需要转义的字符时整段追加
+    int runStart = 0;
+    for (int i = 0; i < utf8.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(utf8.at(i));
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        out->append(utf8.constData() + runStart, i - runStart);
+        runStart = i + 1;
+        switch (c) {
+        case '"': out->append("\\\""); break;
+        case '\\': out->append("\\\\"); break;
+        case '\b': out->append("\\b"); break;
+        case '\f': out->append("\\f"); break;
+        case '\n': out->append("\\n"); break;
+        case '\r': out->append("\\r"); break;
+        case '\t': out->append("\\t"); break;
+        default:
+            out->append("\\u00");
+            out->append(kHex[c >> 4]);
+            out->append(kHex[c & 0x0F]);
+            break;
+        }
+    }
+    out->append(utf8.constData() + runStart, utf8.size() - runStart);
+    out->append('"');
+}
+
+void writeValue(QByteArray *out, double value)
+{
+    // JSON没有NaN和无穷大，与QJsonDocument一样写为null
+    if (!std::isfinite(value)) {
+        out->append("null");
+        return;
+    }
+    out->append(QByteArray::number(value, 'g', 17));
+}
+
+// 任意内容的字段很少使用，交给QJsonDocument
+void writeRaw(QByteArray *out, const QJsonValue &value)
+{
+    switch (value.type()) {
+    case QJsonValue::Bool:
+        writeValue(out, value.toBool());
+        break;
+    case QJsonValue::Double:
+        writeValue(out, value.toDouble());
+        break;
+    case QJsonValue::String:
+        writeString(out, value.toString());
+        break;
+    case QJsonValue::Array:
+        out->append(QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact));
+        break;
+    case QJsonValue::Object:
+        out->append(QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact));
+        break;
+    default:
+        out->append("null");
+        break;
+    }
+}
+
+} // namespace Schema
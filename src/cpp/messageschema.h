@@ -0,0 +1,139 @@
+#ifndef MESSAGESCHEMA_H
+#define MESSAGESCHEMA_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QString>
+#include <type_traits>
+#include "pendingrequesttable.h"
+
+// 类型化消息的编码和解码
+// 消息结构体在messages.h中用字段列表宏定义，每个字段X(类型, 名称)，同一份列表展开为：
+//   - 成员变量；
+//   - writeJson：按字段顺序直接写入JSON字节，不经过QJsonObject；
+//   - readJson：从收到的data对象中读取，缺少或类型不符的字段保持默认值
+// 字段名只在列表中写一次，代码中访问不存在的字段编译失败
+// 支持的字段类型：bool、int、qint64、double、QString、QJsonValue（任意内容）和其他消息结构体
+namespace Schema {
+
+// 写入带引号的字符串，按JSON规则转义
+void writeString(QByteArray *out, const QString &value);
+void writeRaw(QByteArray *out, const QJsonValue &value);
+
+inline void writeValue(QByteArray *out, bool value) { out->append(value ? "true" : "false"); }
+inline void writeValue(QByteArray *out, int value) { out->append(QByteArray::number(value)); }
+inline void writeValue(QByteArray *out, qint64 value) { out->append(QByteArray::number(value)); }
+void writeValue(QByteArray *out, double value);
+inline void writeValue(QByteArray *out, const QString &value) { writeString(out, value); }
+inline void writeValue(QByteArray *out, const QJsonValue &value) { writeRaw(out, value); }
+template <typename T, typename = decltype(std::declval<const T &>().writeJson(nullptr))>
+void writeValue(QByteArray *out, const T &value)
+{
+    value.writeJson(out);
+}
+
+template <typename T>
+void writeField(QByteArray *out, bool *first, const char *name, const T &value)
+{
+    if (!*first) {
+        out->append(',');
+    }
+    *first = false;
+    // 字段名是标识符，不需要转义
+    out->append('"').append(name).append("\":");
+    writeValue(out, value);
+}
+
+inline void readValue(const QJsonValue &value, bool *out) { if (value.isBool()) *out = value.toBool(); }
+inline void readValue(const QJsonValue &value, int *out) { if (value.isDouble()) *out = value.toInt(); }
+inline void readValue(const QJsonValue &value, qint64 *out) { if (value.isDouble()) *out = static_cast<qint64>(value.toDouble()); }
+inline void readValue(const QJsonValue &value, double *out) { if (value.isDouble()) *out = value.toDouble(); }
+inline void readValue(const QJsonValue &value, QString *out) { if (value.isString()) *out = value.toString(); }
+inline void readValue(const QJsonValue &value, QJsonValue *out) { *out = value; }
+template <typename T, typename = decltype(std::declval<T &>().readJson(QJsonObject()))>
+void readValue(const QJsonValue &value, T *out)
+{
+    if (value.isObject()) {
+        out->readJson(value.toObject());
+    }
+}
+
+// 单独的结构体，如sendDirectMessage的内容
+template <typename T>
+QByteArray toJson(const T &value)
+{
+    QByteArray out;
+    value.writeJson(&out);
+    return out;
+}
+
+// 整条请求：{"event":...,"data":{...},"requestId":...}
+template <typename T>
+QByteArray encodeRequest(const T &message, RequestId requestId)
+{
+    QByteArray out;
+    out.reserve(64);
+    // 事件名是schema中的常量，不需要转义
+    out.append("{\"event\":\"").append(T::event).append("\",\"data\":");
+    message.writeJson(&out);
+    out.append(",\"requestId\":").append(QByteArray::number(static_cast<qint64>(requestId))).append('}');
+    return out;
+}
+
+// 从收到的消息中取出data并解码
+template <typename T>
+T decode(const QJsonObject &message)
+{
+    T value;
+    value.readJson(message.value(QLatin1String("data")).toObject());
+    return value;
+}
+
+} // namespace Schema
+
+#define SCHEMA_DECLARE_FIELD(type, name) type name = type();
+#define SCHEMA_WRITE_FIELD(type, name) Schema::writeField(out, &first, #name, name);
+#define SCHEMA_READ_FIELD(type, name) Schema::readValue(object.value(QLatin1String(#name)), &name);
+
+#define SCHEMA_MEMBERS(FIELDS)                      \
+    FIELDS(SCHEMA_DECLARE_FIELD)                    \
+    void writeJson(QByteArray *out) const           \
+    {                                               \
+        bool first = true;                          \
+        Q_UNUSED(first);                            \
+        out->append('{');                           \
+        FIELDS(SCHEMA_WRITE_FIELD)                  \
+        out->append('}');                           \
+    }                                               \
+    void readJson(const QJsonObject &object)        \
+    {                                               \
+        Q_UNUSED(object);                           \
+        FIELDS(SCHEMA_READ_FIELD)                   \
+    }
+
+// 嵌套在消息中的结构体
+#define SCHEMA_STRUCT(Name, FIELDS)                 \
+    struct Name                                     \
+    {                                               \
+        SCHEMA_MEMBERS(FIELDS)                      \
+    };
+
+// 一个事件，字段是消息中data的内容
+#define SCHEMA_MESSAGE(Name, eventName, FIELDS)     \
+    SCHEMA_MESSAGE_IMPL(Name, eventName, false, FIELDS)
+
+// 控制消息，sendRequest按MessagePriority::Control发送，越过排队的普通消息和分块
+#define SCHEMA_CONTROL_MESSAGE(Name, eventName, FIELDS) \
+    SCHEMA_MESSAGE_IMPL(Name, eventName, true, FIELDS)
+
+#define SCHEMA_MESSAGE_IMPL(Name, eventName, isControl, FIELDS) \
+    struct Name                                     \
+    {                                               \
+        static constexpr const char *event = eventName; \
+        static constexpr bool control = isControl;  \
+        SCHEMA_MEMBERS(FIELDS)                      \
+    };
+
+#endif // MESSAGESCHEMA_H
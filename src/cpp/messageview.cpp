@@ -0,0 +1,310 @@
+#include "messageview.h"
+#include <QJsonDocument>
+#include <cstring>
+
+namespace {
+
+inline bool isWhitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline const char *skipWhitespace(const char *p, const char *end)
+{
+    while (p < end && isWhitespace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+inline bool keyEquals(const char *begin, const char *end, const char *name, size_t nameLength)
+{
+    return static_cast<size_t>(end - begin) == nameLength && memcmp(begin, name, nameLength) == 0;
+}
+
+// p指向开头的引号，返回结束引号之后的位置，格式错误返回nullptr；hasEscape表示内容含反斜杠
+// 按引号跳跃查找，引号前有奇数个反斜杠时是转义的引号
+const char *skipString(const char *p, const char *end, bool *hasEscape)
+{
+    ++p;
+    *hasEscape = false;
+    while (p < end) {
+        const char *quote = static_cast<const char *>(memchr(p, '"', end - p));
+        if (!quote) {
+            return nullptr;
+        }
+        if (!*hasEscape && memchr(p, '\\', quote - p)) {
+            *hasEscape = true;
+        }
+        int backslashes = 0;
+        for (const char *q = quote; q > p && q[-1] == '\\'; --q) {
+            ++backslashes;
+        }
+        if (backslashes % 2 == 0) {
+            return quote + 1;
+        }
+        p = quote + 1;
+    }
+    return nullptr;
+}
+
+// 跳过一个值，不检查括号是否配对，完整校验留给QJsonDocument
+const char *skipValue(const char *p, const char *end)
+{
+    if (p >= end) {
+        return nullptr;
+    }
+    bool hasEscape;
+    if (*p == '"') {
+        return skipString(p, end, &hasEscape);
+    }
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            char c = *p;
+            if (c == '"') {
+                p = skipString(p, end, &hasEscape);
+                if (!p) {
+                    return nullptr;
+                }
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                return p + 1;
+            }
+            ++p;
+        }
+        return nullptr;
+    }
+    // 数字、true、false、null
+    const char *start = p;
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && !isWhitespace(*p)) {
+        ++p;
+    }
+    return p == start ? nullptr : p;
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool readHex4(const char *p, const char *end, quint32 *value)
+{
+    if (end - p < 4) {
+        return false;
+    }
+    *value = 0;
+    for (int i = 0; i < 4; ++i) {
+        int digit = hexValue(p[i]);
+        if (digit < 0) {
+            return false;
+        }
+        *value = (*value << 4) | static_cast<quint32>(digit);
+    }
+    return true;
+}
+
+void appendUtf8(QByteArray *out, quint32 codePoint)
+{
+    if (codePoint < 0x80) {
+        out->append(static_cast<char>(codePoint));
+    } else if (codePoint < 0x800) {
+        out->append(static_cast<char>(0xC0 | (codePoint >> 6)));
+        out->append(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    } else if (codePoint < 0x10000) {
+        out->append(static_cast<char>(0xE0 | (codePoint >> 12)));
+        out->append(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        out->append(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    } else {
+        out->append(static_cast<char>(0xF0 | (codePoint >> 18)));
+        out->append(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+        out->append(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        out->append(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+}
+
+// 还原字符串中的转义，格式错误返回false
+bool unescape(const char *p, const char *end, QByteArray *out)
+{
+    out->reserve(static_cast<int>(end - p));
+    while (p < end) {
+        if (*p != '\\') {
+            out->append(*p++);
+            continue;
+        }
+        if (++p >= end) {
+            return false;
+        }
+        char c = *p++;
+        switch (c) {
+        case '"': case '\\': case '/': out->append(c); break;
+        case 'b': out->append('\b'); break;
+        case 'f': out->append('\f'); break;
+        case 'n': out->append('\n'); break;
+        case 'r': out->append('\r'); break;
+        case 't': out->append('\t'); break;
+        case 'u': {
+            quint32 unit;
+            if (!readHex4(p, end, &unit)) {
+                return false;
+            }
+            p += 4;
+            // 代理对
+            quint32 low;
+            if (unit >= 0xD800 && unit < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u'
+                && readHex4(p + 2, end, &low) && low >= 0xDC00 && low < 0xE000) {
+                unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                p += 6;
+            }
+            appendUtf8(out, unit);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+MessageView::MessageView(const QByteArray &json)
+    : m_json(json)
+    , m_requestId(0)
+    , m_hasRequestId(false)
+    , m_valid(false)
+    , m_parsed(false)
+    , m_parseFailed(false)
+{
+    m_valid = scan();
+}
+
+bool MessageView::scan()
+{
+    static const char kEventKey[] = "event";
+    static const char kRequestIdKey[] = "requestId";
+
+    const char *p = m_json.constData();
+    const char *end = p + m_json.size();
+    p = skipWhitespace(p, end);
+    if (p >= end || *p != '{') {
+        return false;
+    }
+    p = skipWhitespace(p + 1, end);
+    if (p < end && *p == '}') {
+        return true;
+    }
+
+    bool haveEvent = false;
+    while (p < end) {
+        if (*p != '"') {
+            return false;
+        }
+        bool hasEscape;
+        const char *keyEnd = skipString(p, end, &hasEscape);
+        if (!keyEnd) {
+            return false;
+        }
+        // 路由字段名不含转义，按原始字节比较
+        const char *keyBegin = p + 1;
+        const char *keyLast = keyEnd - 1;
+        p = skipWhitespace(keyEnd, end);
+        if (p >= end || *p != ':') {
+            return false;
+        }
+        p = skipWhitespace(p + 1, end);
+
+        const char *valueEnd;
+        if (keyEquals(keyBegin, keyLast, kEventKey, sizeof(kEventKey) - 1) && p < end && *p == '"') {
+            valueEnd = skipString(p, end, &hasEscape);
+            if (!valueEnd) {
+                return false;
+            }
+            if (hasEscape) {
+                m_event.clear();
+                if (!unescape(p + 1, valueEnd - 1, &m_event)) {
+                    return false;
+                }
+            } else {
+                m_event = QByteArray::fromRawData(p + 1, static_cast<int>(valueEnd - 1 - (p + 1)));
+            }
+            haveEvent = true;
+        } else if (keyEquals(keyBegin, keyLast, kRequestIdKey, sizeof(kRequestIdKey) - 1)
+                   && p < end && ((*p >= '0' && *p <= '9') || *p == '-')) {
+            valueEnd = skipValue(p, end);
+            if (!valueEnd) {
+                return false;
+            }
+            // 整数直接累加，其他数字形式与QJsonValue::toDouble()的结果一致
+            RequestId id = 0;
+            const char *digit = p;
+            while (digit < valueEnd && *digit >= '0' && *digit <= '9' && digit - p < 19) {
+                id = id * 10 + static_cast<RequestId>(*digit - '0');
+                ++digit;
+            }
+            if (digit != valueEnd) {
+                bool ok = false;
+                double value = QByteArray(p, static_cast<int>(valueEnd - p)).toDouble(&ok);
+                if (!ok) {
+                    return false;
+                }
+                id = value > 0 ? static_cast<RequestId>(value) : 0;
+            }
+            m_requestId = id;
+            m_hasRequestId = true;
+        } else {
+            valueEnd = skipValue(p, end);
+            if (!valueEnd) {
+                return false;
+            }
+        }
+
+        // 两个路由字段都取到后不再扫描剩余部分
+        if (haveEvent && m_hasRequestId) {
+            return true;
+        }
+        p = skipWhitespace(valueEnd, end);
+        if (p >= end) {
+            return false;
+        }
+        if (*p == '}') {
+            return true;
+        }
+        if (*p != ',') {
+            return false;
+        }
+        p = skipWhitespace(p + 1, end);
+    }
+    return false;
+}
+
+const QJsonObject &MessageView::object() const
+{
+    if (!m_parsed) {
+        m_parsed = true;
+        QJsonDocument doc = QJsonDocument::fromJson(m_json);
+        m_parseFailed = !doc.isObject();
+        if (!m_parseFailed) {
+            m_object = doc.object();
+        }
+    }
+    return m_object;
+}
+
+bool MessageView::parseFailed() const
+{
+    object();
+    return m_parseFailed;
+}
@@ -0,0 +1,48 @@
+#ifndef MESSAGEVIEW_H
+#define MESSAGEVIEW_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include "pendingrequesttable.h"
+
+// 收到的一条JSON消息的延迟视图
+// 构造时只扫描一遍顶层键，取出路由用的event和requestId，其他值（data等）直接跳过，不分配内存；
+// 需要完整内容时object()才用QJsonDocument解析并缓存结果
+// json通常指向解码缓冲区，视图只在分发期间有效
+class MessageView
+{
+public:
+    explicit MessageView(const QByteArray &json);
+
+    // 顶层是对象且路由字段格式正确；其余部分在object()时才完整校验
+    bool isValid() const { return m_valid; }
+
+    // event的UTF-8字节，不含转义时指向json，不拷贝
+    const QByteArray &eventBytes() const { return m_event; }
+    QString event() const { return QString::fromUtf8(m_event); }
+
+    // requestId是数字时有效，字符串ID（旧版）视为没有
+    bool hasRequestId() const { return m_hasRequestId; }
+    RequestId requestId() const { return m_requestId; }
+
+    // 完整解析，只解析一次；解析失败返回空对象
+    const QJsonObject &object() const;
+    bool parseFailed() const;
+
+    const QByteArray &json() const { return m_json; }
+
+private:
+    bool scan();
+
+    QByteArray m_json;
+    QByteArray m_event;
+    RequestId m_requestId;
+    bool m_hasRequestId;
+    bool m_valid;
+    mutable bool m_parsed;
+    mutable bool m_parseFailed;
+    mutable QJsonObject m_object;
+};
+
+#endif // MESSAGEVIEW_H
@@ -0,0 +1,140 @@
+#include "pendingrequesttable.h"
+
+PendingRequestTable::PendingRequestTable(int initialCapacity)
+    : m_mask(0)
+    , m_shift(64)
+    , m_size(0)
+{
+    size_t capacity = 8;
+    while (capacity < static_cast<size_t>(initialCapacity)) {
+        capacity <<= 1;
+    }
+    m_slots.resize(capacity);
+    m_mask = capacity - 1;
+    while ((size_t(1) << (64 - m_shift)) < capacity) {
+        --m_shift;
+    }
+}
+
+// Fibonacci哈希，单调递增的ID均匀分散到各个槽位
+size_t PendingRequestTable::indexOf(RequestId id) const
+{
+    return static_cast<size_t>((id * Q_UINT64_C(0x9E3779B97F4A7C15)) >> m_shift) & m_mask;
+}
+
+int PendingRequestTable::find(RequestId id) const
+{
+    if (id == 0) {
+        return -1;
+    }
+    for (size_t i = indexOf(id);; i = (i + 1) & m_mask) {
+        if (m_slots[i].id == id) {
+            return static_cast<int>(i);
+        }
+        if (m_slots[i].id == 0) {
+            return -1;
+        }
+    }
+}
+
+void PendingRequestTable::insert(RequestId id, ResponseCallback callback, qint64 sentAt, int tag)
+{
+    if (id == 0) {
+        return;
+    }
+    if (static_cast<size_t>(m_size + 1) * 2 > m_slots.size()) {
+        grow();
+    }
+
+    size_t i = indexOf(id);
+    while (m_slots[i].id != 0 && m_slots[i].id != id) {
+        i = (i + 1) & m_mask;
+    }
+    if (m_slots[i].id == 0) {
+        m_slots[i].id = id;
+        ++m_size;
+    }
+    m_slots[i].callback = std::move(callback);
+    m_slots[i].sentAt = sentAt;
+    m_slots[i].tag = tag;
+}
+
+ResponseCallback PendingRequestTable::take(RequestId id, qint64 *sentAt, int *tag)
+{
+    int index = find(id);
+    if (index < 0) {
+        return ResponseCallback();
+    }
+    Slot &slot = m_slots[static_cast<size_t>(index)];
+    if (sentAt) {
+        *sentAt = slot.sentAt;
+    }
+    if (tag) {
+        *tag = slot.tag;
+    }
+    ResponseCallback callback = std::move(slot.callback);
+    erase(static_cast<size_t>(index));
+    return callback;
+}
+
+bool PendingRequestTable::contains(RequestId id) const
+{
+    return find(id) >= 0;
+}
+
+// 后移删除：把探测链上可以前移的元素移到空出的槽位，保持查找时遇到空槽即可停止
+void PendingRequestTable::erase(size_t index)
+{
+    size_t hole = index;
+    for (size_t i = (hole + 1) & m_mask; m_slots[i].id != 0; i = (i + 1) & m_mask) {
+        size_t home = indexOf(m_slots[i].id);
+        // home不在(hole, i]区间内时，该元素可以移到hole
+        bool movable = hole <= i ? (home <= hole || home > i) : (home <= hole && home > i);
+        if (movable) {
+            m_slots[hole].id = m_slots[i].id;
+            m_slots[hole].callback = std::move(m_slots[i].callback);
+            m_slots[hole].sentAt = m_slots[i].sentAt;
+            m_slots[hole].tag = m_slots[i].tag;
+            hole = i;
+        }
+    }
+    m_slots[hole].id = 0;
+    m_slots[hole].callback = nullptr;
+    --m_size;
+}
+
+void PendingRequestTable::grow()
+{
+    std::vector<Slot> old;
+    old.swap(m_slots);
+    m_slots.resize(old.size() * 2);
+    m_mask = m_slots.size() - 1;
+    --m_shift;
+    m_size = 0;
+    for (Slot &slot : old) {
+        if (slot.id != 0) {
+            insert(slot.id, std::move(slot.callback), slot.sentAt, slot.tag);
+        }
+    }
+}
+
+void PendingRequestTable::clear()
+{
+    for (Slot &slot : m_slots) {
+        slot.id = 0;
+        slot.callback = nullptr;
+    }
+    m_size = 0;
+}
+
+QVector<RequestId> PendingRequestTable::ids() const
+{
+    QVector<RequestId> result;
+    result.reserve(m_size);
+    for (const Slot &slot : m_slots) {
+        if (slot.id != 0) {
+            result.append(slot.id);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,56 @@
+#ifndef PENDINGREQUESTTABLE_H
+#define PENDINGREQUESTTABLE_H
+
+#include <QtGlobal>
+#include <QJsonObject>
+#include <QVector>
+#include <vector>
+#include "smallfunction.h"
+
+// 请求ID，单调递增，0表示无效
+using RequestId = quint64;
+
+// 响应回调，捕获不超过48字节的lambda不做堆分配
+using ResponseCallback = SmallFunction<void(const QJsonObject &), 48>;
+
+// 等待响应的请求表
+// 以请求ID为键的开放寻址哈希表（线性探测），槽位连续存放，匹配响应只需一次哈希和少量相邻比较；
+// 删除时把后续槽位前移，不留墓碑；负载超过一半时扩容
+class PendingRequestTable
+{
+public:
+    explicit PendingRequestTable(int initialCapacity = 64);
+
+    // id已存在时覆盖；sentAt和tag由调用方解释（发送时刻、统计分类），随回调一起取出
+    void insert(RequestId id, ResponseCallback callback, qint64 sentAt = 0, int tag = -1);
+    // 取出并移除，不存在时返回空回调
+    ResponseCallback take(RequestId id, qint64 *sentAt = nullptr, int *tag = nullptr);
+    bool contains(RequestId id) const;
+    void clear();
+    // 所有等待中的请求ID，按槽位顺序
+    QVector<RequestId> ids() const;
+
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+private:
+    struct Slot
+    {
+        RequestId id = 0; // 0表示空槽
+        ResponseCallback callback;
+        qint64 sentAt = 0;
+        int tag = -1;
+    };
+
+    size_t indexOf(RequestId id) const;
+    int find(RequestId id) const;
+    void erase(size_t index);
+    void grow();
+
+    std::vector<Slot> m_slots;
+    size_t m_mask;
+    int m_shift;
+    int m_size;
+};
+
+#endif // PENDINGREQUESTTABLE_H
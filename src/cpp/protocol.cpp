@@ -0,0 +1,80 @@
+#include "protocol.h"
+#include "crc32c.h"
+#include <QCryptographicHash>
+
+namespace Protocol {
+
+QString checksumModeName(ChecksumMode mode)
+{
+    switch (mode) {
+    case ChecksumMode::Crc32c:
+        return QStringLiteral("crc32c");
+    case ChecksumMode::Sha256:
+        break;
+    }
+    return QStringLiteral("sha256");
+}
+
+bool checksumModeFromName(const QString &name, ChecksumMode *mode)
+{
+    if (name == QLatin1String("crc32c")) {
+        *mode = ChecksumMode::Crc32c;
+        return true;
+    }
+    if (name == QLatin1String("sha256")) {
+        *mode = ChecksumMode::Sha256;
+        return true;
+    }
+    return false;
+}
+
+quint32 checksum(ChecksumMode mode, const char *data, int length)
+{
+    if (mode == ChecksumMode::Crc32c) {
+        return Crc32c::compute(data, static_cast<size_t>(length));
+    }
+
+    // 旧版：SHA-256的前4字节
+    QByteArray result = QCryptographicHash::hash(QByteArray::fromRawData(data, length),
+                                                 QCryptographicHash::Sha256);
+    return readUInt32BE(result.constData());
+}
+
+ChecksumBuilder::ChecksumBuilder(ChecksumMode mode)
+    : m_mode(mode)
+    , m_crc(0)
+    , m_hash(nullptr)
+{
+    if (m_mode == ChecksumMode::Sha256) {
+        m_hash = new QCryptographicHash(QCryptographicHash::Sha256);
+    }
+}
+
+ChecksumBuilder::~ChecksumBuilder()
+{
+    delete m_hash;
+}
+
+void ChecksumBuilder::addData(const char *data, int length)
+{
+    if (m_hash) {
+        // (const char *, int)重载从Qt 6.4起弃用
+#if QT_VERSION >= QT_VERSION_CHECK(6, 4, 0)
+        m_hash->addData(QByteArrayView(data, length));
+#else
+        m_hash->addData(data, length);
+#endif
+    } else {
+        m_crc = Crc32c::extend(m_crc, data, static_cast<size_t>(length));
+    }
+}
+
+quint32 ChecksumBuilder::result()
+{
+    if (m_hash) {
+        return readUInt32BE(m_hash->result().constData());
+    }
+    return m_crc;
+}
+
+} // namespace Protocol
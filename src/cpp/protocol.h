@@ -0,0 +1,172 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
+
+class QCryptographicHash;
+
+// 帧格式：[4字节长度][2字节类型][负载][4字节校验]
+// 长度只计算负载，校验覆盖类型字段和负载
+// 类型字段：第1字节为负载类型，第2字节为标志位
+// 协议版本2起每帧前加2字节同步标记，见SyncMarker
+namespace Protocol {
+
+const int LengthFieldSize = 4;
+const int TypeFieldSize = 2;
+const int ChecksumFieldSize = 4;
+const int HeaderSize = LengthFieldSize + TypeFieldSize;
+const int FrameOverhead = HeaderSize + ChecksumFieldSize;
+
+// 协议版本，连接后在握手消息（protocol_hello）中交换，双方按较小的版本工作
+// 1：基础帧格式；2：帧前加同步标记
+const int Version = 2;
+// 单帧解压后负载的默认上限，握手时告知对端，对端不发送超过该大小的单帧
+const int DefaultMaxPayloadSize = 256 * 1024 * 1024;
+
+// 同步标记：[0xA5 0x5A][4字节长度][2字节类型][负载][4字节校验]，标记不在校验范围内
+// 握手确定版本2后，双方此后写出的每帧都带标记；旧版帧以长度开头，长度不超过int范围时第1字节不会是0xA5，
+// 解码端据此逐帧区分两种格式。数据损坏或长度异常时，解码端跳到下一个同步标记重新分帧
+const int SyncMarkerVersion = 2;
+const quint8 SyncMarker0 = 0xA5;
+const quint8 SyncMarker1 = 0x5A;
+const int SyncMarkerSize = 2;
+
+// 负载类型（类型字段第1字节）
+const char PayloadJson = '0';
+// 二进制负载：[4字节元数据长度][元数据JSON][二进制数据]
+// 元数据包含event、requestId等路由字段，二进制数据不做base64编码
+const char PayloadBinary = 'B';
+const char PayloadImage = 'I';
+const int BinaryMetaLengthSize = 4;
+
+inline bool isBinaryPayloadType(char type)
+{
+    return type == PayloadBinary || type == PayloadImage;
+}
+
+// 批量负载：若干条[4字节长度][JSON消息]首尾相接，每条消息与单独的JSON帧含义相同
+const char PayloadBatch = 'M';
+const int BatchItemLengthSize = 4;
+
+// 分块负载，大负载拆成多帧发送，控制消息可以插在分块之间
+// [4字节流ID][4字节序号][1字节分块标志][分块数据]
+// 序号0的分块数据以[4字节元数据长度][元数据JSON]开头，元数据描述整个流（event、requestId、type）
+const char PayloadChunk = 'C';
+const int ChunkHeaderSize = 9;
+const quint8 ChunkFinal = 0x01;
+const int DefaultChunkSize = 64 * 1024;
+
+// 共享内存描述符负载，数据在共享内存环形缓冲区（SharedRing）中，帧里只有位置
+// [4字节元数据长度][元数据JSON][1字节实际负载类型][4字节位置][4字节长度]，元数据与二进制负载相同
+const char PayloadShared = 'S';
+const int SharedDescriptorSize = 9;
+
+// 标志位（类型字段第2字节）
+// 旧版对端固定发送ASCII '0'，最高位为0，表示SHA-256截断校验、无其他扩展
+// 最高位为1时，bit0-1为校验模式，bit2-3为压缩算法
+const quint8 LegacyFlags = '0';
+const quint8 FlagExtended = 0x80;
+const quint8 ChecksumModeMask = 0x03;
+const quint8 CompressionShift = 2;
+const quint8 CompressionMask = 0x0C;
+const quint8 ReservedFlagsMask = 0x70;
+
+enum class ChecksumMode : quint8 {
+    Sha256 = 0, // SHA-256前4字节（旧版兼容）
+    Crc32c = 1  // CRC32C，硬件加速
+};
+
+// 压缩算法，压缩后的负载为[4字节原始长度][压缩数据]，校验覆盖压缩后的数据
+enum class CompressionCodec : quint8 {
+    None = 0,
+    Deflate = 1, // zlib，两端都内置
+    Lz4 = 2,     // 低延迟
+    Zstd = 3     // 高压缩率
+};
+
+const int CompressedLengthSize = 4;
+
+inline quint8 makeFlags(ChecksumMode mode, CompressionCodec codec = CompressionCodec::None)
+{
+    if (mode == ChecksumMode::Sha256 && codec == CompressionCodec::None) {
+        return LegacyFlags;
+    }
+    return FlagExtended | static_cast<quint8>(mode)
+           | static_cast<quint8>(static_cast<quint8>(codec) << CompressionShift);
+}
+
+inline CompressionCodec compressionFromFlags(quint8 flags)
+{
+    if (!(flags & FlagExtended)) {
+        return CompressionCodec::None;
+    }
+    return static_cast<CompressionCodec>((flags & CompressionMask) >> CompressionShift);
+}
+
+inline ChecksumMode checksumModeFromFlags(quint8 flags)
+{
+    if (!(flags & FlagExtended)) {
+        return ChecksumMode::Sha256;
+    }
+    return static_cast<ChecksumMode>(flags & ChecksumModeMask);
+}
+
+inline bool isKnownChecksumMode(quint8 flags)
+{
+    return !(flags & FlagExtended) || (flags & ChecksumModeMask) <= static_cast<quint8>(ChecksumMode::Crc32c);
+}
+
+// 标志位是否是合法取值：旧版固定为'0'，扩展格式的保留位为0且校验模式已知
+// 重新同步时用来排除数据中偶然出现的同步标记
+inline bool isWellFormedFlags(quint8 flags)
+{
+    return flags == LegacyFlags
+           || ((flags & FlagExtended) && !(flags & ReservedFlagsMask) && isKnownChecksumMode(flags));
+}
+
+// 协商时使用的名称："sha256" / "crc32c"
+QString checksumModeName(ChecksumMode mode);
+bool checksumModeFromName(const QString &name, ChecksumMode *mode);
+
+// 按指定模式计算校验值
+quint32 checksum(ChecksumMode mode, const char *data, int length);
+
+// 分段计算校验值，结果与对拼接后的数据连续计算相同
+class ChecksumBuilder
+{
+public:
+    explicit ChecksumBuilder(ChecksumMode mode);
+    ~ChecksumBuilder();
+
+    void addData(const char *data, int length);
+    quint32 result();
+
+private:
+    ChecksumMode m_mode;
+    quint32 m_crc;
+    QCryptographicHash *m_hash;
+
+    Q_DISABLE_COPY(ChecksumBuilder)
+};
+
+inline quint32 readUInt32BE(const char *p)
+{
+    return (static_cast<quint32>(static_cast<quint8>(p[0])) << 24) |
+           (static_cast<quint32>(static_cast<quint8>(p[1])) << 16) |
+           (static_cast<quint32>(static_cast<quint8>(p[2])) << 8) |
+           static_cast<quint32>(static_cast<quint8>(p[3]));
+}
+
+inline void writeUInt32BE(char *p, quint32 value)
+{
+    p[0] = static_cast<char>((value >> 24) & 0xFF);
+    p[1] = static_cast<char>((value >> 16) & 0xFF);
+    p[2] = static_cast<char>((value >> 8) & 0xFF);
+    p[3] = static_cast<char>(value & 0xFF);
+}
+
+} // namespace Protocol
+
+#endif // PROTOCOL_H
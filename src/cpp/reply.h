@@ -0,0 +1,302 @@
+#ifndef REPLY_H
+#define REPLY_H
+
+#include <QtGlobal>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <utility>
+#include "pendingrequesttable.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define REPLY_HAS_COROUTINES 1
+#endif
+
+// 错误响应，与等待表超时、断开时回调收到的格式相同
+inline QJsonObject makeErrorResponse(RequestId requestId, const QString &code, const QString &message)
+{
+    QJsonObject data;
+    data["code"] = code;
+    data["message"] = message;
+    QJsonObject response;
+    response["event"] = "error";
+    if (requestId != 0) {
+        response["requestId"] = static_cast<qint64>(requestId);
+    }
+    response["data"] = data;
+    return response;
+}
+
+inline bool isErrorResponse(const QJsonObject &response)
+{
+    return response["event"].toString() == QLatin1String("error");
+}
+
+// 取消后的结果：单个响应是code为cancelled的错误响应，其他类型为默认值
+template <typename T>
+T cancelledResult()
+{
+    return T();
+}
+
+template <>
+inline QJsonObject cancelledResult<QJsonObject>()
+{
+    return makeErrorResponse(0, "cancelled", "请求已取消");
+}
+
+// 异步请求的结果，可以复制，副本共享同一个状态
+// 结果只设置一次：收到响应（包括超时、断开等错误响应）或取消
+// 获取方式：
+//   - onFinished()注册完成回调；
+//   - future()得到QFuture，可以配合QFutureWatcher使用；
+//   - 编译器支持C++20协程时可以直接co_await，得到结果
+// 完成回调和协程在设置结果的线程中继续执行：TcpClient是它所在的线程，ThreadedTcpClient是界面线程
+// 取消只影响本地：结果立即变为取消，之后到达的响应被忽略
+template <typename T>
+class Reply
+{
+public:
+    using Continuation = std::function<void()>;
+
+    Reply() : m_state(QSharedPointer<State>::create())
+    {
+        m_state->future.reportStarted();
+    }
+
+    // 已完成的结果
+    static Reply finished(const T &value)
+    {
+        Reply reply;
+        reply.finish(value);
+        return reply;
+    }
+
+    bool isFinished() const
+    {
+        QMutexLocker locker(&m_state->mutex);
+        return m_state->finished;
+    }
+
+    bool isCanceled() const
+    {
+        QMutexLocker locker(&m_state->mutex);
+        return m_state->canceled;
+    }
+
+    // 未完成时返回默认值
+    T result() const
+    {
+        QMutexLocker locker(&m_state->mutex);
+        return m_state->value;
+    }
+
+    QFuture<T> future() const
+    {
+        return m_state->future.future();
+    }
+
+    // 设置结果，已完成时忽略；返回是否由本次调用完成
+    bool finish(const T &value) const
+    {
+        return complete(value, false);
+    }
+
+    void cancel() const
+    {
+        complete(cancelledResult<T>(), true);
+    }
+
+    // 完成后调用callback，已完成时立即在当前线程调用
+    void onFinished(Continuation callback) const
+    {
+        if (!addContinuation(callback)) {
+            callback();
+        }
+    }
+
+private:
+    struct State;
+
+public:
+    // 不持有状态的引用：登记在自身状态中的完成回调用它读取结果，
+    // 否则回调和状态互相引用，一直没有结果的请求永远不会释放；状态已释放时返回默认值
+    class Weak
+    {
+    public:
+        Weak(const Reply &reply) : m_state(reply.m_state) {}
+
+        bool isCanceled() const
+        {
+            QSharedPointer<State> state = m_state.toStrongRef();
+            return state && Reply(state).isCanceled();
+        }
+
+        T result() const
+        {
+            QSharedPointer<State> state = m_state.toStrongRef();
+            return state ? Reply(state).result() : T();
+        }
+
+        void cancel() const
+        {
+            QSharedPointer<State> state = m_state.toStrongRef();
+            if (state) {
+                Reply(state).cancel();
+            }
+        }
+
+    private:
+        QWeakPointer<State> m_state;
+    };
+
+#ifdef REPLY_HAS_COROUTINES
+    bool await_ready() const { return isFinished(); }
+    bool await_suspend(std::coroutine_handle<> handle) const
+    {
+        // 注册前已完成时不挂起，协程直接继续
+        return addContinuation([handle]() { handle.resume(); });
+    }
+    T await_resume() const { return result(); }
+#endif
+
+private:
+    struct State
+    {
+        QMutex mutex;
+        bool finished = false;
+        bool canceled = false;
+        T value = T();
+        QVector<Continuation> continuations;
+        QFutureInterface<T> future;
+    };
+
+    explicit Reply(QSharedPointer<State> state) : m_state(std::move(state)) {}
+
+    bool addContinuation(Continuation continuation) const
+    {
+        QMutexLocker locker(&m_state->mutex);
+        if (m_state->finished) {
+            return false;
+        }
+        m_state->continuations.append(std::move(continuation));
+        return true;
+    }
+
+    bool complete(const T &value, bool canceled) const
+    {
+        QVector<Continuation> continuations;
+        {
+            QMutexLocker locker(&m_state->mutex);
+            if (m_state->finished) {
+                return false;
+            }
+            m_state->finished = true;
+            m_state->canceled = canceled;
+            m_state->value = value;
+            continuations.swap(m_state->continuations);
+        }
+        if (canceled) {
+            m_state->future.cancel();
+        } else {
+            m_state->future.reportResult(value);
+        }
+        m_state->future.reportFinished();
+        // 在锁外调用，回调中可以发起新的请求或等待其他结果
+        for (const Continuation &continuation : continuations) {
+            continuation();
+        }
+        return true;
+    }
+
+    QSharedPointer<State> m_state;
+};
+
+using JsonReply = Reply<QJsonObject>;
+
+// 全部完成后按原顺序得到所有结果；取消返回值时一并取消所有请求
+template <typename T>
+Reply<QVector<T>> whenAll(const QVector<Reply<T>> &replies)
+{
+    Reply<QVector<T>> all;
+    if (replies.isEmpty()) {
+        all.finish(QVector<T>());
+        return all;
+    }
+
+    struct Collector
+    {
+        QVector<T> results;
+        std::atomic<int> remaining;
+    };
+    QSharedPointer<Collector> collector = QSharedPointer<Collector>::create();
+    collector->results.resize(replies.size());
+    collector->remaining.store(replies.size(), std::memory_order_relaxed);
+    for (int i = 0; i < replies.size(); ++i) {
+        Reply<T> reply = replies.at(i);
+        typename Reply<T>::Weak weakReply(reply);
+        reply.onFinished([all, collector, weakReply, i]() {
+            // 各结果写入不同位置，最后完成的一方看到全部结果
+            collector->results[i] = weakReply.result();
+            if (collector->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                all.finish(collector->results);
+            }
+        });
+    }
+    // 各请求的完成回调持有all，all的回调只持有各请求的弱引用，不形成循环
+    QVector<typename Reply<T>::Weak> weakReplies;
+    for (const Reply<T> &reply : replies) {
+        weakReplies.append(typename Reply<T>::Weak(reply));
+    }
+    typename Reply<QVector<T>>::Weak weakAll(all);
+    all.onFinished([weakAll, weakReplies]() {
+        if (weakAll.isCanceled()) {
+            for (const typename Reply<T>::Weak &reply : weakReplies) {
+                reply.cancel();
+            }
+        }
+    });
+    return all;
+}
+
+// 第一个完成的结果，其余请求继续进行，需要时由调用方取消；
+// 单个响应可以按其中的requestId区分来自哪个请求
+template <typename T>
+Reply<T> whenAny(const QVector<Reply<T>> &replies)
+{
+    Reply<T> any;
+    for (const Reply<T> &reply : replies) {
+        typename Reply<T>::Weak weakReply(reply);
+        reply.onFinished([any, weakReply]() { any.finish(weakReply.result()); });
+    }
+    return any;
+}
+
+#ifdef REPLY_HAS_COROUTINES
+// 不返回结果的协程，创建后立即执行，在第一个co_await处挂起，完成时自行销毁
+//   AsyncTask run(ThreadedTcpClient *client)
+//   {
+//       QJsonObject result = co_await client->request(request);
+//       ...
+//   }
+struct AsyncTask
+{
+    struct promise_type
+    {
+        AsyncTask get_return_object() { return AsyncTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+#endif
+
+#endif // REPLY_H
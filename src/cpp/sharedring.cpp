@@ -0,0 +1,144 @@
+#include "sharedring.h"
+#include <QDir>
+#include <QFile>
+#include <QSysInfo>
+#include <QtEndian>
+#include <atomic>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int kMagicOffset = 0;
+const int kVersionOffset = 4;
+const int kCapacityOffset = 8;
+const int kReadPositionOffset = 12;
+
+static_assert(sizeof(std::atomic<quint32>) == sizeof(quint32), "读位置按32位原子变量访问");
+
+std::atomic<quint32> *readPositionField(char *base)
+{
+    return reinterpret_cast<std::atomic<quint32> *>(base + kReadPositionOffset);
+}
+
+} // namespace
+
+qintptr SharedRing::create(quint32 capacity)
+{
+#ifdef Q_OS_UNIX
+    // 头部按小端直接映射为原子变量，只支持小端机器
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian || capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return -1;
+    }
+    int descriptor = -1;
+#ifdef Q_OS_LINUX
+    descriptor = ::memfd_create("ai-agent-ring", MFD_CLOEXEC);
+#endif
+    if (descriptor < 0) {
+        // 没有memfd时使用临时文件，创建后删除路径，只能通过描述符访问
+        QByteArray path = QFile::encodeName(QDir::tempPath() + "/ai-agent-ring-XXXXXX");
+        descriptor = ::mkstemp(path.data());
+        if (descriptor < 0) {
+            return -1;
+        }
+        ::unlink(path.constData());
+        ::fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+    }
+    if (::ftruncate(descriptor, HeaderSize + static_cast<off_t>(capacity)) != 0) {
+        ::close(descriptor);
+        return -1;
+    }
+
+    char header[16] = {};
+    qToLittleEndian<quint32>(Magic, header + kMagicOffset);
+    qToLittleEndian<quint32>(Version, header + kVersionOffset);
+    qToLittleEndian<quint32>(capacity, header + kCapacityOffset);
+    if (::pwrite(descriptor, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        ::close(descriptor);
+        return -1;
+    }
+    return descriptor;
+#else
+    Q_UNUSED(capacity);
+    return -1;
+#endif
+}
+
+SharedRing *SharedRing::attach(qintptr descriptor)
+{
+#ifdef Q_OS_UNIX
+    struct stat info;
+    if (descriptor < 0 || ::fstat(static_cast<int>(descriptor), &info) != 0 || info.st_size <= HeaderSize) {
+        return nullptr;
+    }
+    void *base = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED,
+                        static_cast<int>(descriptor), 0);
+    if (base == MAP_FAILED) {
+        return nullptr;
+    }
+    char *header = static_cast<char *>(base);
+    quint32 capacity = qFromLittleEndian<quint32>(header + kCapacityOffset);
+    if (qFromLittleEndian<quint32>(header + kMagicOffset) != Magic
+        || qFromLittleEndian<quint32>(header + kVersionOffset) != Version
+        || capacity == 0 || (capacity & (capacity - 1)) != 0
+        || HeaderSize + static_cast<qint64>(capacity) > info.st_size) {
+        ::munmap(base, static_cast<size_t>(info.st_size));
+        return nullptr;
+    }
+    return new SharedRing(header, info.st_size, capacity);
+#else
+    Q_UNUSED(descriptor);
+    return nullptr;
+#endif
+}
+
+SharedRing::SharedRing(char *base, qint64 mappedSize, quint32 capacity)
+    : m_base(base)
+    , m_mappedSize(mappedSize)
+    , m_capacity(capacity)
+{
+}
+
+SharedRing::~SharedRing()
+{
+#ifdef Q_OS_UNIX
+    ::munmap(m_base, static_cast<size_t>(m_mappedSize));
+#endif
+}
+
+bool SharedRing::view(quint32 position, quint32 length, QByteArray *data) const
+{
+    quint32 offset = position & (m_capacity - 1);
+    // 写端写入的数据都在[读位置, 读位置 + 容量)内
+    if (length > m_capacity || offset + static_cast<quint64>(length) > m_capacity
+        || static_cast<quint32>(position + length - readPosition()) > m_capacity) {
+        return false;
+    }
+    *data = QByteArray::fromRawData(m_base + HeaderSize + offset, static_cast<int>(length));
+    return true;
+}
+
+// 写端在写入数据前读取读位置，release保证之前对这段数据的读取都已完成
+void SharedRing::release(quint32 end)
+{
+    readPositionField(m_base)->store(end, std::memory_order_release);
+}
+
+void SharedRing::discard(quint32 position, quint32 length)
+{
+    quint32 end = position + length;
+    if (static_cast<quint32>(end - readPosition()) <= m_capacity) {
+        release(end);
+    }
+}
+
+quint32 SharedRing::readPosition() const
+{
+    return readPositionField(m_base)->load(std::memory_order_acquire);
+}
@@ -0,0 +1,51 @@
+#ifndef SHAREDRING_H
+#define SHAREDRING_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+// 共享内存环形缓冲区
+// 同机的Node子进程把截图等大负载写在这里，连接上只发送描述符帧（负载类型'S'），
+// 数据不再经过base64、socket和帧解码
+// 布局：[64字节头部][数据区]，头部字段为小端：
+//   0  4字节魔数"AGSR"
+//   4  4字节版本
+//   8  4字节数据区容量（2的幂）
+//   12 4字节读位置，本端处理完描述符后推进，写端据此判断剩余空间
+// 位置是取模前的累计字节数（32位回绕），写位置只由写端保存；一段数据在数据区内总是连续的
+// Linux上是memfd，其他Unix上是删除了路径的临时文件；Windows不支持
+class SharedRing
+{
+public:
+    static const int HeaderSize = 64;
+    static const quint32 Magic = 0x52534741; // "AGSR"
+    static const quint32 Version = 1;
+
+    // 创建共享内存并初始化头部，返回带FD_CLOEXEC的描述符；失败或平台不支持时返回-1
+    static qintptr create(quint32 capacity);
+    // 映射已创建的共享内存，描述符仍归调用方，映射后可以关闭；失败返回nullptr
+    static SharedRing *attach(qintptr descriptor);
+
+    ~SharedRing();
+
+    quint32 capacity() const { return m_capacity; }
+    // 取[position, position + length)的数据，零拷贝，在release()越过这段数据之前有效
+    // 位置不在写端可能写过的范围内或跨越数据区末尾时返回false
+    bool view(quint32 position, quint32 length, QByteArray *data) const;
+    // 到end为止的数据已处理完，写端可以覆盖
+    void release(quint32 end);
+    // 跳过无效的描述符：这段数据的结尾在写端可能写过的范围内时越过它，否则读位置不变
+    void discard(quint32 position, quint32 length);
+
+private:
+    SharedRing(char *base, qint64 mappedSize, quint32 capacity);
+    quint32 readPosition() const;
+
+    char *m_base;
+    qint64 m_mappedSize;
+    quint32 m_capacity;
+
+    Q_DISABLE_COPY(SharedRing)
+};
+
+#endif // SHAREDRING_H
@@ -0,0 +1,170 @@
+#ifndef SMALLFUNCTION_H
+#define SMALLFUNCTION_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 小缓冲区优化的可调用对象包装，接口与std::function相同
+// 不超过Capacity字节、可无异常移动的可调用对象直接存放在对象内部，不做堆分配；
+// 更大的可调用对象回退到堆上
+template <typename Signature, std::size_t Capacity = 48>
+class SmallFunction;
+
+template <typename R, typename... Args, std::size_t Capacity>
+class SmallFunction<R(Args...), Capacity>
+{
+public:
+    SmallFunction() noexcept : m_ops(nullptr) {}
+    SmallFunction(std::nullptr_t) noexcept : m_ops(nullptr) {}
+
+    template <typename F,
+              typename Fn = typename std::decay<F>::type,
+              typename = typename std::enable_if<!std::is_same<Fn, SmallFunction>::value
+                                                 && std::is_invocable_r<R, Fn &, Args...>::value>::type>
+    SmallFunction(F &&f) : m_ops(nullptr)
+    {
+        if (isEmptyCallable(f)) {
+            return;
+        }
+        if constexpr (fitsInline<Fn>()) {
+            new (m_storage) Fn(std::forward<F>(f));
+            m_ops = &InlineModel<Fn>::ops;
+        } else {
+            *reinterpret_cast<Fn **>(m_storage) = new Fn(std::forward<F>(f));
+            m_ops = &HeapModel<Fn>::ops;
+        }
+    }
+
+    SmallFunction(const SmallFunction &other) : m_ops(other.m_ops)
+    {
+        if (m_ops) {
+            m_ops->copy(m_storage, other.m_storage);
+        }
+    }
+
+    SmallFunction(SmallFunction &&other) noexcept : m_ops(other.m_ops)
+    {
+        if (m_ops) {
+            m_ops->move(m_storage, other.m_storage);
+            other.m_ops = nullptr;
+        }
+    }
+
+    ~SmallFunction() { reset(); }
+
+    SmallFunction &operator=(const SmallFunction &other)
+    {
+        if (this != &other) {
+            SmallFunction copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    SmallFunction &operator=(SmallFunction &&other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            if (other.m_ops) {
+                m_ops = other.m_ops;
+                m_ops->move(m_storage, other.m_storage);
+                other.m_ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    SmallFunction &operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    explicit operator bool() const noexcept { return m_ops != nullptr; }
+
+    R operator()(Args... args) const
+    {
+        return m_ops->invoke(const_cast<unsigned char *>(m_storage), std::forward<Args>(args)...);
+    }
+
+private:
+    struct Ops
+    {
+        R (*invoke)(void *storage, Args &&...args);
+        void (*copy)(void *dst, const void *src);
+        void (*move)(void *dst, void *src); // 移动后销毁src
+        void (*destroy)(void *storage);
+    };
+
+    template <typename Fn>
+    static constexpr bool fitsInline()
+    {
+        return sizeof(Fn) <= Capacity && alignof(Fn) <= alignof(std::max_align_t)
+               && std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+    // 空的函数指针和std::function按空对象处理，与std::function一致
+    template <typename F>
+    static bool isEmptyCallable(const F &f)
+    {
+        return isNull(f, 0);
+    }
+    template <typename F>
+    static auto isNull(const F &f, int) -> decltype(f == nullptr)
+    {
+        return f == nullptr;
+    }
+    template <typename F>
+    static bool isNull(const F &, long)
+    {
+        return false;
+    }
+
+    template <typename Fn>
+    struct InlineModel
+    {
+        static Fn *get(void *storage) { return static_cast<Fn *>(storage); }
+        static R invoke(void *storage, Args &&...args) { return (*get(storage))(std::forward<Args>(args)...); }
+        static void copy(void *dst, const void *src) { new (dst) Fn(*static_cast<const Fn *>(src)); }
+        static void move(void *dst, void *src)
+        {
+            new (dst) Fn(std::move(*get(src)));
+            get(src)->~Fn();
+        }
+        static void destroy(void *storage) { get(storage)->~Fn(); }
+        static constexpr Ops ops = {&invoke, &copy, &move, &destroy};
+    };
+
+    template <typename Fn>
+    struct HeapModel
+    {
+        static Fn *&get(void *storage) { return *static_cast<Fn **>(storage); }
+        static R invoke(void *storage, Args &&...args) { return (*get(storage))(std::forward<Args>(args)...); }
+        static void copy(void *dst, const void *src)
+        {
+            *static_cast<Fn **>(dst) = new Fn(**static_cast<Fn *const *>(src));
+        }
+        static void move(void *dst, void *src)
+        {
+            *static_cast<Fn **>(dst) = get(src);
+            get(src) = nullptr;
+        }
+        static void destroy(void *storage) { delete get(storage); }
+        static constexpr Ops ops = {&invoke, &copy, &move, &destroy};
+    };
+
+    void reset() noexcept
+    {
+        if (m_ops) {
+            m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char m_storage[Capacity];
+    const Ops *m_ops;
+};
+
+#endif // SMALLFUNCTION_H
@@ -0,0 +1,85 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// 单生产者单消费者无锁队列，不限长度
+// 元素按块存放，每块BlockSize个，生产者写满一块后追加新块，消费者读完一块后释放；
+// push只能在一个线程调用，tryPop只能在另一个线程调用
+template <typename T, int BlockSize = 64>
+class SpscQueue
+{
+public:
+    SpscQueue() : m_readBlock(new Block), m_readIndex(0), m_writeBlock(m_readBlock) {}
+
+    ~SpscQueue()
+    {
+        Block *block = m_readBlock;
+        while (block) {
+            Block *next = block->next.load(std::memory_order_relaxed);
+            delete block;
+            block = next;
+        }
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // 生产者线程
+    void push(T value)
+    {
+        int index = m_writeBlock->written.load(std::memory_order_relaxed);
+        if (index == BlockSize) {
+            Block *block = new Block;
+            block->items[0] = std::move(value);
+            block->written.store(1, std::memory_order_relaxed);
+            // next的release保证消费者看到新块时也看到其中的第一个元素
+            m_writeBlock->next.store(block, std::memory_order_release);
+            m_writeBlock = block;
+            return;
+        }
+        m_writeBlock->items[index] = std::move(value);
+        m_writeBlock->written.store(index + 1, std::memory_order_release);
+    }
+
+    // 消费者线程，队列为空时返回false
+    bool tryPop(T *value)
+    {
+        for (;;) {
+            int written = m_readBlock->written.load(std::memory_order_acquire);
+            if (m_readIndex < written) {
+                *value = std::move(m_readBlock->items[m_readIndex]);
+                m_readBlock->items[m_readIndex] = T();
+                ++m_readIndex;
+                return true;
+            }
+            if (written < BlockSize) {
+                return false;
+            }
+            Block *next = m_readBlock->next.load(std::memory_order_acquire);
+            if (!next) {
+                return false;
+            }
+            delete m_readBlock;
+            m_readBlock = next;
+            m_readIndex = 0;
+        }
+    }
+
+private:
+    struct Block
+    {
+        T items[BlockSize];
+        std::atomic<int> written{0};
+        std::atomic<Block *> next{nullptr};
+    };
+
+    // 消费者独占
+    Block *m_readBlock;
+    int m_readIndex;
+    // 生产者独占
+    Block *m_writeBlock;
+};
+
+#endif // SPSCQUEUE_H
@@ -1,409 +1,1998 @@
 #include "tcpclient.h"
 #include <QJsonObject>
 #include <QJsonDocument>
+#include <QJsonArray>
 #include <QByteArray>
-#include <QCryptographicHash>
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <QThread>
+#include <algorithm>
+#include "compression.h"
+#include "messageview.h"
+#include "messages.h"
+
+namespace {
+
+// 默认十六进制输出的最大字节数
+const int kDefaultHexdumpLimit = 256;
+// 发送缓冲区默认水位和发送队列上限
+const qint64 kDefaultHighWatermark = 4 * 1024 * 1024;
+const qint64 kDefaultLowWatermark = 1024 * 1024;
+const qint64 kDefaultMaxQueuedBytes = 16 * 1024 * 1024;
+// 写缓冲区中普通消息的默认上限，控制消息最多排在这么多数据后面
+const qint64 kDefaultWriteBudget = 256 * 1024;
+// 单次连接的超时时间
+const int kConnectTimeoutMs = 3000;
+// 等待握手回复的时间，超时视为旧版对端
+const int kHelloTimeoutMs = 1000;
+// setMaxFrameSize的上限，保证帧长度和缓冲区偏移不超出int
+const int kMaxFrameSizeLimit = 1024 * 1024 * 1024;
+// 没有流处理函数时，拼接的分块流上限
+const qint64 kMaxStreamSize = 256 * 1024 * 1024;
+
+// 格式化十六进制输出，每行16字节，超出total的部分标注截断
+QString formatHexDump(const QByteArray &bytes, qint64 total)
+{
+    static const char digits[] = "0123456789abcdef";
+    QByteArray text;
+    text.reserve(bytes.size() * 3 + bytes.size() / 16 + 32);
+    for (int i = 0; i < bytes.size(); ++i) {
+        quint8 byte = static_cast<quint8>(bytes[i]);
+        text.append(digits[byte >> 4]);
+        text.append(digits[byte & 0x0F]);
+        text.append((i + 1) % 16 == 0 ? '\n' : ' ');
+    }
+    if (total > bytes.size()) {
+        text.append("... (共" + QByteArray::number(total) + " 字节，已截断)");
+    }
+    return QString::fromUtf8(text);
+}
+
+} // namespace
 
 TcpClient::TcpClient(QObject *parent)
     : QObject(parent)
+    , m_transport(nullptr)
+    , m_nextRequestId(1)
+    , m_timeoutTimer(this)
+    , m_state(ConnectionState::Disconnected)
+    , m_connectTimer(this)
+    , m_reconnectTimer(this)
+    , m_autoReconnect(false)
+    , m_reconnectWanted(false)
+    , m_reconnectInitialDelay(500)
+    , m_reconnectMaxDelay(30000)
+    , m_reconnectAttempt(0)
+    , m_heartbeatTimer(this)
+    , m_heartbeatInterval(0)
+    , m_heartbeatMissedLimit(3)
+    , m_nextPingSeq(1)
+    , m_outstandingPings(0)
+    , m_rttSampled(false)
+    , m_peerUnresponsive(false)
+    , m_coalesceWrites(false)
+    , m_flushScheduled(false)
+    , m_highWatermark(kDefaultHighWatermark)
+    , m_lowWatermark(kDefaultLowWatermark)
+    , m_maxQueuedBytes(kDefaultMaxQueuedBytes)
+    , m_queuedBytes(0)
+    , m_writeBudget(kDefaultWriteBudget)
+    , m_writeBlocked(false)
+    , m_preferredChecksumMode(Protocol::ChecksumMode::Crc32c)
+    , m_preferredCompression(Protocol::CompressionCodec::None)
+    , m_peerVersion(0)
+    , m_peerMaxPayloadSize(Protocol::DefaultMaxPayloadSize)
+    , m_helloTimer(this)
+    , m_sharedRing(nullptr)
+    , m_nextStreamId(1)
+    , m_chunkSize(Protocol::DefaultChunkSize)
+    , m_streamBytes(0)
+    , m_nextSubscriptionId(1)
+    , m_logLevel(LogLevel::Info)
+    , m_hexdumpLimit(kDefaultHexdumpLimit)
 {
-    // 连接信号槽
-    connect(&m_socket, &QTcpSocket::connected, this, &TcpClient::onConnected);
-    connect(&m_socket, &QTcpSocket::disconnected, this, &TcpClient::onDisconnected);
-    connect(&m_socket, &QTcpSocket::readyRead, this, &TcpClient::onReadyRead);
-    
-    // 使用新的errorOccurred信号替代过时的error信号
-    connect(&m_socket, &QAbstractSocket::errorOccurred, this, &TcpClient::onError);
+    // 默认接收二进制和图片负载，通过binaryMessage信号转发
+    for (char type : {Protocol::PayloadBinary, Protocol::PayloadImage}) {
+        registerPayloadType(type, [this, type](const QJsonObject &meta, const QByteArray &data) {
+            // data指向接收缓冲区，信号可能被排队，这里拷贝一份
+            emit binaryMessage(type, meta, QByteArray(data.constData(), data.size()));
+        });
+    }
     
-    // 设置超时定时器
+    // 设置超时定时器，每个tick推进一次时间轮，有等待中的请求时才启动
     m_timeoutTimer.setSingleShot(false);
-    m_timeoutTimer.setInterval(1000); // 每秒检查一次超时
+    m_timeoutTimer.setInterval(m_deadlines.tickMs());
     connect(&m_timeoutTimer, &QTimer::timeout, this, &TcpClient::onTimeout);
-    m_timeoutTimer.start();
+    
+    // 连接超时和退避重连
+    m_connectTimer.setSingleShot(true);
+    connect(&m_connectTimer, &QTimer::timeout, this, &TcpClient::onConnectTimeout);
+    m_reconnectTimer.setSingleShot(true);
+    connect(&m_reconnectTimer, &QTimer::timeout, this, &TcpClient::startConnect);
+    m_helloTimer.setSingleShot(true);
+    connect(&m_helloTimer, &QTimer::timeout, this, &TcpClient::onHelloTimeout);
+    connect(&m_heartbeatTimer, &QTimer::timeout, this, &TcpClient::onHeartbeat);
+    m_clock.start();
 }
 
 TcpClient::~TcpClient()
 {
-    disconnectFromServer();
+    if (m_transport) {
+        // 析构期间不再处理传输层信号，剩余数据最多等待1秒写出
+        disconnectTransport();
+        flushWrites();
+        if (m_transport->isConnected()) {
+            m_transport->close();
+            if (!m_transport->isClosed()) {
+                m_transport->waitForDisconnected(1000);
+            }
+        }
+    }
+    delete m_sharedRing;
 }
 
-bool TcpClient::connectToServer(const QString &host, quint16 port)
+void TcpClient::connectToServer(const QString &host, quint16 port)
 {
-    if (m_socket.state() == QAbstractSocket::ConnectedState) {
-        return true;
+    connectToServer(TransportEndpoint::tcp(host, port));
+}
+
+void TcpClient::connectToServer(const TransportEndpoint &endpoint)
+{
+    m_reconnectWanted = true;
+    if (m_state == ConnectionState::Connected || m_state == ConnectionState::Connecting) {
+        return;
+    }
+    
+    // 换新的传输层；旧的可能正处在自己的信号中，延后释放
+    if (m_transport) {
+        disconnectTransport();
+        m_transport->abort();
+        m_transport->deleteLater();
     }
+    m_transport = Transport::create(endpoint, this);
+    // 共享内存只映射一次，之后的重连沿用
+    if (!m_sharedRing && endpoint.sharedMemoryDescriptor >= 0) {
+        m_sharedRing = SharedRing::attach(endpoint.sharedMemoryDescriptor);
+        if (shouldLog(LogLevel::Info)) {
+            emit logMessage(m_sharedRing
+                            ? QString("已映射共享内存，容量%1字节").arg(m_sharedRing->capacity())
+                            : QString("映射共享内存失败，大负载通过连接发送"));
+        }
+    }
+    QIODevice *device = m_transport->device();
+    connect(m_transport, &Transport::connected, this, &TcpClient::onConnected);
+    connect(m_transport, &Transport::disconnected, this, &TcpClient::onDisconnected);
+    connect(m_transport, &Transport::errorOccurred, this, &TcpClient::onError);
+    connect(device, &QIODevice::readyRead, this, &TcpClient::onReadyRead);
+    // 写缓冲区有空间后继续发送排队的帧和分块
+    connect(device, &QIODevice::bytesWritten, this, &TcpClient::onBytesWritten);
     
-    m_socket.connectToHost(host, port);
-    return m_socket.waitForConnected(3000); // 等待连接最多3秒
+    m_reconnectTimer.stop();
+    startConnect();
+}
+
+void TcpClient::disconnectTransport()
+{
+    m_transport->disconnect(this);
+    m_transport->device()->disconnect(this);
 }
 
 void TcpClient::disconnectFromServer()
 {
-    if (m_socket.state() != QAbstractSocket::UnconnectedState) {
-        m_socket.disconnectFromHost();
-        if (m_socket.state() != QAbstractSocket::UnconnectedState) {
-            m_socket.waitForDisconnected(1000);
-        }
+    m_reconnectWanted = false;
+    m_reconnectTimer.stop();
+    m_connectTimer.stop();
+    m_reconnectClock.invalidate();
+    
+    if (isConnected()) {
+        // 剩余数据由socket在后台写完，收到disconnected后清理
+        flushWrites();
+        m_transport->close();
+        return;
+    }
+    
+    if (m_transport) {
+        m_transport->abort();
+    }
+    if (m_state != ConnectionState::Disconnected) {
+        setState(ConnectionState::Disconnected);
+        failAllPendingRequests(false);
     }
 }
 
 bool TcpClient::isConnected() const
 {
-    return m_socket.state() == QAbstractSocket::ConnectedState;
+    return m_transport && m_transport->isConnected();
+}
+
+TcpClient::ConnectionState TcpClient::connectionState() const
+{
+    return m_state;
+}
+
+void TcpClient::setAutoReconnect(bool enabled, int initialDelayMs, int maxDelayMs)
+{
+    m_autoReconnect = enabled;
+    m_reconnectInitialDelay = qMax(1, initialDelayMs);
+    m_reconnectMaxDelay = qMax(m_reconnectInitialDelay, maxDelayMs);
+    if (!enabled && m_state == ConnectionState::Reconnecting) {
+        m_reconnectTimer.stop();
+        m_reconnectClock.invalidate();
+        setState(ConnectionState::Disconnected);
+        failAllPendingRequests(false);
+    }
+}
+
+void TcpClient::setHeartbeat(int intervalMs, int missedLimit)
+{
+    m_heartbeatInterval = qMax(0, intervalMs);
+    m_heartbeatMissedLimit = qMax(1, missedLimit);
+    if (m_heartbeatInterval == 0) {
+        m_heartbeatTimer.stop();
+        m_outstandingPings = 0;
+        m_peerUnresponsive = false;
+    } else if (m_state == ConnectionState::Connected && m_peerVersion > 0) {
+        startHeartbeat();
+    }
+}
+
+bool TcpClient::isPeerResponsive() const
+{
+    return !m_peerUnresponsive;
+}
+
+void TcpClient::startHeartbeat()
+{
+    if (m_heartbeatInterval > 0) {
+        m_heartbeatTimer.start(m_heartbeatInterval);
+    }
+}
+
+// 上一个间隔内的ping没有回复时计为丢失，连续丢失达到上限发出peerUnresponsive，只发一次
+void TcpClient::onHeartbeat()
+{
+    if (m_state != ConnectionState::Connected) {
+        return;
+    }
+    if (m_outstandingPings > 0) {
+        ClientMetrics::add(m_metrics.missedPongs);
+        if (!m_peerUnresponsive && m_outstandingPings >= m_heartbeatMissedLimit) {
+            m_peerUnresponsive = true;
+            if (shouldLog(LogLevel::Error)) {
+                emit logMessage(QString("对端连续%1次未回复心跳").arg(m_outstandingPings));
+            }
+            emit peerUnresponsive(m_outstandingPings);
+        }
+    }
+
+    QJsonObject data;
+    data["seq"] = static_cast<qint64>(m_nextPingSeq++);
+    data["t"] = m_clock.elapsed();
+    QJsonObject ping;
+    ping["event"] = "ping";
+    ping["data"] = data;
+    writeControlFrame(buildProtocolMessage(ping));
+    ++m_outstandingPings;
+}
+
+// RTT按RFC 6298平滑：第一个样本SRTT=R、RTTVAR=R/2，之后RTTVAR=3/4*RTTVAR+1/4*|SRTT-R|，SRTT=7/8*SRTT+1/8*R
+void TcpClient::handlePong(const QJsonObject &data)
+{
+    qint64 rtt = m_clock.elapsed() - static_cast<qint64>(data["t"].toDouble());
+    if (rtt < 0) {
+        return;
+    }
+    // 只在网络线程写入，其他线程只读
+    double srtt = m_metrics.smoothedRttMs.load(std::memory_order_relaxed);
+    double rttvar = m_metrics.rttVarianceMs.load(std::memory_order_relaxed);
+    if (!m_rttSampled) {
+        m_rttSampled = true;
+        srtt = rtt;
+        rttvar = rtt / 2.0;
+    } else {
+        rttvar = 0.75 * rttvar + 0.25 * qAbs(srtt - rtt);
+        srtt = 0.875 * srtt + 0.125 * rtt;
+    }
+    double loopLag = data["loopLagMs"].toDouble();
+    m_metrics.lastRttMs.store(rtt, std::memory_order_relaxed);
+    m_metrics.smoothedRttMs.store(srtt, std::memory_order_relaxed);
+    m_metrics.rttVarianceMs.store(rttvar, std::memory_order_relaxed);
+    m_metrics.peerLoopLagMs.store(loopLag, std::memory_order_relaxed);
+    m_outstandingPings = 0;
+    if (m_peerUnresponsive) {
+        m_peerUnresponsive = false;
+        if (shouldLog(LogLevel::Info)) {
+            emit logMessage(QString("对端恢复响应，RTT %1ms").arg(rtt));
+        }
+        emit peerRecovered();
+    }
+    if (shouldLog(LogLevel::Frame)) {
+        emit logMessage(QString("心跳RTT %1ms，平滑%2ms，对端事件循环延迟%3ms")
+                        .arg(rtt).arg(srtt, 0, 'f', 1).arg(loopLag, 0, 'f', 1));
+    }
 }
 
-QString TcpClient::sendMessage(const QString &message, ResponseCallback callback)
+RequestId TcpClient::sendMessage(const QString &message, ResponseCallback callback,
+                                 const RequestOptions &options)
 {
     QJsonObject request;
     request["event"] = "message";
     request["data"] = message;
-    return sendRequest(request, callback);
+    return sendRequest(request, callback, options);
 }
 
-QString TcpClient::sendCalculateRequest(int a, int b, ResponseCallback callback)
+RequestId TcpClient::sendCalculateRequest(int a, int b, ResponseCallback callback,
+                                          const RequestOptions &options)
 {
-    QJsonObject request;
-    request["event"] = "calculate";
-    QJsonObject data;
-    data["a"] = a;
-    data["b"] = b;
-    request["data"] = data;
-    return sendRequest(request, callback);
+    CalculateRequest request;
+    request.a = a;
+    request.b = b;
+    request.operation = "add";
+    return sendRequest(request, callback, options);
 }
 
-QString TcpClient::sendExecuteCommand(const QString &type, const QString &command, ResponseCallback callback)
+RequestId TcpClient::sendExecuteCommand(const QString &type, const QString &command, ResponseCallback callback,
+                                        const RequestOptions &options)
+{
+    // 按{event, data, requestId}发送，对端据requestId找到执行该指令的Agent，取消时随之停止
+    ExecuteCommand request;
+    request.command = command;
+    request.type = type;
+    return sendRequest(request, callback, options);
+}
+
+RequestId TcpClient::sendDirectMessage(const QString &message, ResponseCallback callback,
+                                       const RequestOptions &options)
 {
     if (!isConnected()) {
         emit error("未连接到服务器");
-        return QString();
+        return 0;
     }
     
-    // 直接构建命令JSON字符串，不使用{event, data}包装
-    QJsonObject commandData;
-    commandData["command"] = command;
-    commandData["type"] = type;
-    QJsonDocument commandDoc(commandData);
-    QByteArray jsonData = commandDoc.toJson(QJsonDocument::Compact);
-    
-    // 生成请求ID用于回调
-    QString requestId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    // 生成唯一请求ID
+    RequestId requestId = takeRequestId(options);
     
-    // 存储回调
-    if (callback) {
-        m_pendingRequests[requestId] = callback;
+    // 直接发送字符串消息
+    QByteArray messageData = message.toUtf8();
+    if (!writeFrame(buildProtocolMessageDirect(messageData), options, requestId)) {
+        return 0;
     }
     
-    // 直接发送JSON字符串（不使用协议包装）
-    emit logMessage("发送execute_command JSON: " + QString::fromUtf8(jsonData));
+    // 存储回调
+    addPendingRequest(requestId, std::move(callback), options.timeoutMs, "direct");
     
-    // 构建协议消息并发送
-    QByteArray protocolMessage = buildProtocolMessageDirect(jsonData);
-    m_socket.write(protocolMessage);
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage("发送直接消息: " + message);
+    }
     
     return requestId;
 }
 
-QString TcpClient::sendDirectMessage(const QString &message, ResponseCallback callback)
+RequestId TcpClient::sendRequest(const QJsonObject &request, ResponseCallback callback,
+                               const RequestOptions &options)
 {
     if (!isConnected()) {
         emit error("未连接到服务器");
-        return QString();
+        return 0;
     }
     
     // 生成唯一请求ID
-    QString requestId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    RequestId requestId = takeRequestId(options);
     
-    // 存储回调
-    if (callback) {
-        m_pendingRequests[requestId] = callback;
+    // 添加请求ID
+    QJsonObject requestWithId = request;
+    requestWithId["requestId"] = static_cast<qint64>(requestId);
+    
+    // 构建协议消息并发送
+    if (!writeFrame(buildProtocolMessage(requestWithId), options, requestId)) {
+        return 0;
     }
     
-    // 直接发送字符串消息
-    QByteArray messageData = message.toUtf8();
-    QByteArray protocolMessage = buildProtocolMessageDirect(messageData);
-    m_socket.write(protocolMessage);
+    // 存储回调
+    if (options.idempotent && callback) {
+        rememberForReplay(requestId, Protocol::PayloadJson, requestWithId);
+    }
+    addPendingRequest(requestId, std::move(callback), options.timeoutMs, requestWithId["event"].toString());
     
-    emit logMessage("发送直接消息: " + message);
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage("发送请求: " + requestWithId["event"].toString());
+    }
     
     return requestId;
 }
 
-QString TcpClient::sendRequest(const QJsonObject &request, ResponseCallback callback)
+RequestId TcpClient::reserveRequestId(int count)
+{
+    return m_nextRequestId.fetch_add(static_cast<RequestId>(qMax(1, count)), std::memory_order_relaxed);
+}
+
+// 调用方预先分配了ID时使用该ID，否则分配一个新的
+RequestId TcpClient::takeRequestId(const RequestOptions &options)
+{
+    return options.requestId != 0 ? options.requestId : reserveRequestId();
+}
+
+// 类型化请求已编码为完整的JSON，包含requestId
+bool TcpClient::sendEncodedRequest(RequestId requestId, const char *event, const QByteArray &jsonData,
+                                   ResponseCallback callback, const RequestOptions &options)
+{
+    if (!writeFrame(buildProtocolMessageDirect(jsonData), options, requestId)) {
+        return false;
+    }
+    
+    // 存储回调
+    if (options.idempotent && callback) {
+        rememberForReplay(requestId, Protocol::PayloadJson, QJsonObject(), jsonData);
+    }
+    addPendingRequest(requestId, std::move(callback), options.timeoutMs, QString::fromLatin1(event));
+    
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage("发送请求: " + QString::fromLatin1(event));
+    }
+    return true;
+}
+
+JsonReply TcpClient::request(const QJsonObject &message, const RequestOptions &options)
+{
+    JsonReply reply;
+    RequestId requestId = sendRequest(message, [reply](const QJsonObject &response) {
+        reply.finish(response);
+    }, options);
+    if (requestId == 0) {
+        reply.finish(isConnected() ? makeErrorResponse(0, "rejected", "发送缓冲区已满")
+                                   : makeErrorResponse(0, "disconnected", "未连接到服务器"));
+        return reply;
+    }
+    // cancel()可能在其他线程调用，转到本对象所在线程取消请求；请求已完成时cancel返回false，没有影响
+    QPointer<TcpClient> self(this);
+    JsonReply::Weak weakReply(reply);
+    reply.onFinished([self, weakReply, requestId]() {
+        if (weakReply.isCanceled() && self) {
+            QMetaObject::invokeMethod(self, [self, requestId]() {
+                if (self) {
+                    self->cancel(requestId);
+                }
+            });
+        }
+    });
+    return reply;
+}
+
+RequestId TcpClient::sendBinary(const QString &event, const QByteArray &data, ResponseCallback callback,
+                             char payloadType, const QJsonObject &meta, const RequestOptions &options)
 {
     if (!isConnected()) {
         emit error("未连接到服务器");
-        return QString();
+        return 0;
     }
     
+    // 超过对端单帧上限时分块发送；超过一个分块的负载也分块发送，之后的控制消息最多排在一个分块后面，
+    // 不必等整个大帧写完。分块流不重发，可重发的请求仍整帧发送
+    if (m_peerPayloadTypes.contains(Protocol::PayloadChunk)
+        && (data.size() >= m_peerMaxPayloadSize || (data.size() > m_chunkSize && !options.idempotent))) {
+        return sendStream(event, data, callback, payloadType, meta, options);
+    }
+    // 对端不支持分块时，超过其单帧上限的帧会被丢弃，调用方只能等到超时，这里直接拒绝
+    if (data.size() >= m_peerMaxPayloadSize) {
+        emit error(QString("二进制负载%1字节超过对端单帧上限").arg(data.size()));
+        if (callback) {
+            callback(makeErrorResponse(0, "too_large", "负载超过对端单帧上限"));
+        }
+        return 0;
+    }
+
     // 生成唯一请求ID
-    QString requestId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    RequestId requestId = takeRequestId(options);
+
+    // 元数据携带路由字段，二进制数据原样发送
+    QJsonObject frameMeta = meta;
+    frameMeta["event"] = event;
+    frameMeta["requestId"] = static_cast<qint64>(requestId);
     
-    // 添加请求ID
-    QJsonObject requestWithId = request;
-    requestWithId["requestId"] = requestId;
+    if (!writeFrame(buildBinaryMessage(payloadType, frameMeta, data), options, requestId)) {
+        return 0;
+    }
     
     // 存储回调
-    if (callback) {
-        m_pendingRequests[requestId] = callback;
+    if (options.idempotent && callback) {
+        rememberForReplay(requestId, payloadType, frameMeta, data);
     }
+    addPendingRequest(requestId, std::move(callback), options.timeoutMs, event);
     
-    // 构建协议消息并发送
-    QByteArray protocolMessage = buildProtocolMessage(requestWithId);
-    m_socket.write(protocolMessage);
-    
-    emit logMessage("发送请求: " + requestWithId["event"].toString());
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage("发送二进制请求: " + event);
+    }
     
     return requestId;
 }
 
-// 构建协议消息
-QByteArray TcpClient::buildProtocolMessage(const QJsonObject &message)
+QVector<RequestId> TcpClient::sendBatch(const QVector<BatchRequest> &requests, const RequestOptions &options)
 {
-    // 转换为JSON字符串
-    QJsonDocument doc(message);
-    QByteArray jsonData = doc.toJson(QJsonDocument::Compact);
-    
-    // 调试输出：打印JSON字符串
-    emit logMessage("发送JSON: " + QString::fromUtf8(jsonData));
-    
-    // 构建消息体：[2字节类型][JSON数据]
-    QByteArray messageBody;
-    // 使用ASCII字符'00'匹配Node.js端格式
-    messageBody.append("00"); // 类型字段，使用ASCII字符匹配Node.js
-    messageBody.append(jsonData);
-    
-    // 计算CRC32
-    quint32 crc = calculateCRC32(messageBody);
-    
-    // 构建完整消息：[4字节长度][消息体][4字节CRC]
-    QByteArray fullMessage;
-    
-    // 长度头（Big Endian）- 只计算JSON数据的长度
-    QByteArray lengthHeader(4, 0);
-    quint32 messageLength = jsonData.length(); // 注意：这里只计算JSON数据长度
-    lengthHeader[0] = (messageLength >> 24) & 0xFF;
-    lengthHeader[1] = (messageLength >> 16) & 0xFF;
-    lengthHeader[2] = (messageLength >> 8) & 0xFF;
-    lengthHeader[3] = messageLength & 0xFF;
+    QVector<RequestId> requestIds;
+    if (!isConnected()) {
+        emit error("未连接到服务器");
+        return requestIds;
+    }
+    if (requests.isEmpty()) {
+        return requestIds;
+    }
     
-    // CRC（Big Endian）
-    QByteArray crcBytes(4, 0);
-    crcBytes[0] = (crc >> 24) & 0xFF;
-    crcBytes[1] = (crc >> 16) & 0xFF;
-    crcBytes[2] = (crc >> 8) & 0xFF;
-    crcBytes[3] = crc & 0xFF;
+    // 旧版对端不认识批量帧，逐条发送，写入失败的请求ID为0
+    bool packed = m_peerPayloadTypes.contains(Protocol::PayloadBatch);
+    RequestId firstRequestId = options.requestId != 0 ? options.requestId : reserveRequestId(requests.size());
+    QList<QByteArray> messages;
+    QVector<QJsonObject> sentRequests;
+    requestIds.reserve(requests.size());
+    for (const BatchRequest &item : requests) {
+        RequestId requestId = firstRequestId + requestIds.size();
+        QJsonObject requestWithId = item.request;
+        requestWithId["requestId"] = static_cast<qint64>(requestId);
+        if (options.idempotent) {
+            sentRequests.append(requestWithId);
+        }
+        
+        if (packed) {
+            QByteArray jsonData = QJsonDocument(requestWithId).toJson(QJsonDocument::Compact);
+            if (shouldLog(LogLevel::Frame)) {
+                emit logMessage("发送JSON: " + QString::fromUtf8(jsonData));
+            }
+            messages.append(jsonData);
+        } else if (!writeFrame(buildProtocolMessage(requestWithId), options, requestId)) {
+            requestId = 0;
+        }
+        requestIds.append(requestId);
+    }
     
-    fullMessage.append(lengthHeader);
-    fullMessage.append(messageBody);
-    fullMessage.append(crcBytes);
+    // 批量帧中的请求ID连续，整帧按一个发送单元排队或丢弃
+    if (packed) {
+        EncodedFrame frame = FrameEncoder::encodeBatch(m_encoding, messages);
+        logEncodedFrame(frame, "批量消息");
+        if (!writeFrame(frame, options, requestIds.first(), static_cast<int>(requestIds.size()))) {
+            return QVector<RequestId>();
+        }
+    }
     
-    // 调试输出：打印二进制消息内容
-    QString hexString;
-    for (int i = 0; i < fullMessage.size(); ++i) {
-        hexString += QString("%1 ").arg(static_cast<unsigned char>(fullMessage[i]), 2, 16, QChar('0'));
-        if ((i + 1) % 16 == 0) hexString += "\n";
+    // 重连后逐条重发，不再打包
+    for (int i = 0; i < requestIds.size(); ++i) {
+        if (requestIds[i] == 0) {
+            continue;
+        }
+        if (options.idempotent && requests[i].callback) {
+            rememberForReplay(requestIds[i], Protocol::PayloadJson, sentRequests[i]);
+        }
+        addPendingRequest(requestIds[i], requests[i].callback, options.timeoutMs, requests[i].request["event"].toString());
     }
-    emit logMessage("发送二进制数据 (" + QString::number(fullMessage.size()) + " 字节):\n" + hexString);
     
-    // 分段输出便于理解
-    emit logMessage("长度头: " + QString::number(messageLength) + " 字节 (只计算JSON数据)");
-    emit logMessage("消息体长度: " + QString::number(messageBody.length()) + " 字节");
-    emit logMessage("CRC32: 0x" + QString::number(crc, 16).toUpper());
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage(QString("发送批量请求: %1 条").arg(requests.size()));
+    }
     
-    return fullMessage;
+    return requestIds;
 }
 
-// 直接构建协议消息（不使用JSON包装）
-QByteArray TcpClient::buildProtocolMessageDirect(const QByteArray &rawData)
+void TcpClient::setWriteCoalescing(bool enabled)
 {
-    // 调试输出：打印原始数据
-    emit logMessage("发送原始数据: " + QString::fromUtf8(rawData));
-    
-    // 构建消息体：[2字节类型][原始数据]
-    QByteArray messageBody;
-    // 使用ASCII字符'00'匹配Node.js端格式
-    messageBody.append("00"); // 类型字段，使用ASCII字符匹配Node.js
-    messageBody.append(rawData);
-    
-    // 计算CRC32
-    quint32 crc = calculateCRC32(messageBody);
+    if (!enabled) {
+        flushWrites();
+    }
+    m_coalesceWrites = enabled;
+}
+
+RequestId TcpClient::sendStream(const QString &event, const QByteArray &data, ResponseCallback callback,
+                             char payloadType, const QJsonObject &meta, const RequestOptions &options)
+{
+    // 旧版对端不认识分块帧，整体发送
+    if (!m_peerPayloadTypes.contains(Protocol::PayloadChunk)) {
+        return sendBinary(event, data, callback, payloadType, meta, options);
+    }
+    if (!isConnected()) {
+        emit error("未连接到服务器");
+        return 0;
+    }
+    // 分块按写缓冲区的空闲情况逐块发送，不进入发送队列；尚未发出的部分与发送队列一起计入水位和队列上限，
+    // 高水位时按sendPolicy处理
+    if (!admitToQueue(data.size(), options.sendPolicy, 1)) {
+        return 0;
+    }
     
-    // 构建完整消息：[4字节长度][消息体][4字节CRC]
-    QByteArray fullMessage;
+    // 生成唯一请求ID
+    RequestId requestId = takeRequestId(options);
     
-    // 长度头（Big Endian）- 只计算原始数据的长度
-    QByteArray lengthHeader(4, 0);
-    quint32 messageLength = rawData.length(); // 注意：这里只计算原始数据长度
-    lengthHeader[0] = (messageLength >> 24) & 0xFF;
-    lengthHeader[1] = (messageLength >> 16) & 0xFF;
-    lengthHeader[2] = (messageLength >> 8) & 0xFF;
-    lengthHeader[3] = messageLength & 0xFF;
+    // 元数据随第一个分块发送，描述整个流
+    QJsonObject streamMeta = meta;
+    streamMeta["event"] = event;
+    streamMeta["requestId"] = static_cast<qint64>(requestId);
+    streamMeta["type"] = QString(QLatin1Char(payloadType));
+    streamMeta["size"] = static_cast<qint64>(data.size());
     
-    // CRC（Big Endian）
-    QByteArray crcBytes(4, 0);
-    crcBytes[0] = (crc >> 24) & 0xFF;
-    crcBytes[1] = (crc >> 16) & 0xFF;
-    crcBytes[2] = (crc >> 8) & 0xFF;
-    crcBytes[3] = crc & 0xFF;
+    // 存储回调
+    addPendingRequest(requestId, std::move(callback), options.timeoutMs, event);
     
-    fullMessage.append(lengthHeader);
-    fullMessage.append(messageBody);
-    fullMessage.append(crcBytes);
+    OutgoingStream stream;
+    stream.id = m_nextStreamId++;
+    stream.requestId = requestId;
+    stream.policy = options.sendPolicy;
+    stream.meta = QJsonDocument(streamMeta).toJson(QJsonDocument::Compact);
+    stream.data = data;
+    stream.offset = 0;
+    stream.sequence = 0;
+    m_outgoingStreams.append(stream);
+    m_streamBytes += data.size();
+    checkHighWatermark();
     
-    // 调试输出：打印二进制消息内容
-    QString hexString;
-    for (int i = 0; i < fullMessage.size(); ++i) {
-        hexString += QString("%1 ").arg(static_cast<unsigned char>(fullMessage[i]), 2, 16, QChar('0'));
-        if ((i + 1) % 16 == 0) hexString += "\n";
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage(QString("发送分块请求: %1, %2 字节").arg(event).arg(data.size()));
     }
-    emit logMessage("发送二进制数据 (" + QString::number(fullMessage.size()) + " 字节):\n" + hexString);
-    
-    // 分段输出便于理解
-    emit logMessage("长度头: " + QString::number(messageLength) + " 字节 (只计算原始数据)");
-    emit logMessage("消息体长度: " + QString::number(messageBody.length()) + " 字节");
-    emit logMessage("CRC32: 0x" + QString::number(crc, 16).toUpper());
     
-    return fullMessage;
+    pumpStreams();
+    return requestId;
 }
 
-// 计算CRC32（简化版，使用SHA256的前4字节）
-quint32 TcpClient::calculateCRC32(const QByteArray &data)
+void TcpClient::setChunkSize(int bytes)
 {
-    QCryptographicHash hash(QCryptographicHash::Sha256);
-    hash.addData(data);
-    QByteArray result = hash.result();
-    
-    // 取前4字节作为CRC32
-    quint32 crc = 0;
-    if (result.size() >= 4) {
-        crc = (static_cast<quint8>(result[0]) << 24) |
-              (static_cast<quint8>(result[1]) << 16) |
-              (static_cast<quint8>(result[2]) << 8) |
-              static_cast<quint8>(result[3]);
+    m_chunkSize = qMax(1, bytes);
+}
+
+void TcpClient::registerStreamHandler(const QString &event, StreamHandler handler)
+{
+    if (handler) {
+        m_streamHandlers.insert(event, handler);
+    } else {
+        m_streamHandlers.remove(event);
     }
-    
-    return crc;
 }
 
-// 处理接收到的数据（黏包处理）
-void TcpClient::processReceivedData(const QByteArray &data)
+void TcpClient::registerPayloadType(char payloadType, PayloadHandler handler)
 {
-    m_receiveBuffer.append(data);
-    
-    while (m_receiveBuffer.length() >= 4) {
-        // 读取消息长度 (Node.js端的length是payloadBuf.length，即JSON数据长度)
-        quint32 messageLength = (static_cast<quint8>(m_receiveBuffer[0]) << 24) |
-                               (static_cast<quint8>(m_receiveBuffer[1]) << 16) |
-                               (static_cast<quint8>(m_receiveBuffer[2]) << 8) |
-                               static_cast<quint8>(m_receiveBuffer[3]);
-        
-        quint32 fullMessageLength = 4 + 2 + messageLength + 4; // 长度头+类型+JSON数据+CRC
-        
-        if (m_receiveBuffer.length() >= fullMessageLength) {
-            // 提取消息部分：[2字节类型][JSON数据]
-            QByteArray messageBody = m_receiveBuffer.mid(4, 2 + messageLength);
-            QByteArray crcBytes = m_receiveBuffer.mid(4 + 2 + messageLength, 4);
-            
-            // 验证CRC
-            quint32 receivedCrc = (static_cast<quint8>(crcBytes[0]) << 24) |
-                                 (static_cast<quint8>(crcBytes[1]) << 16) |
-                                 (static_cast<quint8>(crcBytes[2]) << 8) |
-                                 static_cast<quint8>(crcBytes[3]);
-            
-            quint32 calculatedCrc = calculateCRC32(messageBody);
-            
-            emit logMessage("收到消息长度: " + QString::number(messageLength));
-            emit logMessage("消息体长度: " + QString::number(messageBody.length()));
-            emit logMessage("接收CRC: 0x" + QString::number(receivedCrc, 16).toUpper());
-            emit logMessage("计算CRC: 0x" + QString::number(calculatedCrc, 16).toUpper());
-            
-            if (receivedCrc == calculatedCrc) {
-                // CRC验证通过，解析消息
-                // 跳过2字节类型字段，获取JSON数据
-                QByteArray jsonData = messageBody.mid(2);
-                
-                emit logMessage("接收JSON: " + QString::fromUtf8(jsonData));
-                
-                try {
-                    QJsonDocument doc = QJsonDocument::fromJson(jsonData);
-                    if (doc.isObject()) {
-                        QJsonObject response = doc.object();
-                        
-                        // 检查是否有请求ID
-                        if (response.contains("requestId")) {
-                            QString requestId = response["requestId"].toString();
-                            
-                            // 查找对应的回调
-                            if (m_pendingRequests.contains(requestId)) {
-                                ResponseCallback callback = m_pendingRequests[requestId];
-                                if (callback) {
-                                    callback(response);
-                                }
-                                
-                                // 从等待列表中移除
-                                m_pendingRequests.remove(requestId);
-                            }
-                        }
-                        
-                        emit logMessage("收到响应: " + response["event"].toString());
-                    }
-                } catch (...) {
-                    emit error("解析响应失败");
-                }
-            } else {
-                emit logMessage("CRC验证失败，丢弃消息");
-            }
-            
-            // 从缓冲区移除已处理的消息
-            m_receiveBuffer.remove(0, fullMessageLength);
-        } else {
-            // 数据不完整，等待更多数据
-            break;
+    if (payloadType == Protocol::PayloadJson) {
+        return;
+    }
+    if (handler) {
+        m_payloadHandlers.insert(payloadType, handler);
+    } else {
+        m_payloadHandlers.remove(payloadType);
+    }
+}
+
+void TcpClient::setPreferredChecksumMode(Protocol::ChecksumMode mode)
+{
+    m_preferredChecksumMode = mode;
+    if (mode == Protocol::ChecksumMode::Sha256) {
+        m_encoding.checksum = mode;
+    }
+}
+
+Protocol::ChecksumMode TcpClient::checksumMode() const
+{
+    return m_encoding.checksum;
+}
+
+void TcpClient::setCompression(Protocol::CompressionCodec codec, int threshold)
+{
+    m_preferredCompression = Compression::isAvailable(codec) ? codec : Protocol::CompressionCodec::Deflate;
+    m_encoding.compressionThreshold = qMax(0, threshold);
+    if (codec == Protocol::CompressionCodec::None) {
+        m_encoding.compression = codec;
+    }
+}
+
+Protocol::CompressionCodec TcpClient::compressionCodec() const
+{
+    return m_encoding.compression;
+}
+
+void TcpClient::setMaxFrameSize(int bytes)
+{
+    m_decoder.setMaxPayloadSize(qBound(Protocol::DefaultChunkSize, bytes, kMaxFrameSizeLimit));
+}
+
+int TcpClient::maxFrameSize() const
+{
+    return m_decoder.maxPayloadSize();
+}
+
+NegotiatedProtocol TcpClient::negotiated() const
+{
+    NegotiatedProtocol protocol;
+    protocol.version = m_peerVersion;
+    protocol.peerMaxPayloadSize = m_peerMaxPayloadSize;
+    protocol.checksum = m_encoding.checksum;
+    protocol.compression = m_encoding.compression;
+    protocol.syncMarker = m_encoding.syncMarker;
+    protocol.payloadTypes = m_peerPayloadTypes;
+    return protocol;
+}
+
+void TcpClient::setLogLevel(LogLevel level)
+{
+    m_logLevel = level;
+}
+
+TcpClient::LogLevel TcpClient::logLevel() const
+{
+    return m_logLevel;
+}
+
+void TcpClient::setHexdumpLimit(int bytes)
+{
+    m_hexdumpLimit = qMax(0, bytes);
+}
+
+// 本端期望的校验模式，首选在前；只接受SHA-256时为空
+QJsonArray TcpClient::checksumModeOffer() const
+{
+    QJsonArray modes;
+    if (m_preferredChecksumMode != Protocol::ChecksumMode::Sha256) {
+        modes.append(Protocol::checksumModeName(m_preferredChecksumMode));
+        modes.append(Protocol::checksumModeName(Protocol::ChecksumMode::Sha256));
+    }
+    return modes;
+}
+
+// 本端支持的压缩算法，首选在前；不压缩时为空
+QJsonArray TcpClient::compressionCodecOffer() const
+{
+    QJsonArray codecs;
+    if (m_preferredCompression == Protocol::CompressionCodec::None) {
+        return codecs;
+    }
+    codecs.append(Compression::codecName(m_preferredCompression));
+    for (Protocol::CompressionCodec codec : Compression::availableCodecs()) {
+        if (codec != m_preferredCompression) {
+            codecs.append(Compression::codecName(codec));
         }
     }
+    return codecs;
 }
 
-void TcpClient::onConnected()
+// 本端能接收的负载类型
+QJsonArray TcpClient::localPayloadTypes() const
 {
-    emit connected();
-    emit logMessage("已连接到服务器");
+    QJsonArray types;
+    for (auto it = m_payloadHandlers.constBegin(); it != m_payloadHandlers.constEnd(); ++it) {
+        types.append(QString(QLatin1Char(it.key())));
+    }
+    types.append(QString(QLatin1Char(Protocol::PayloadChunk)));
+    types.append(QString(QLatin1Char(Protocol::PayloadBatch)));
+    if (m_sharedRing) {
+        types.append(QString(QLatin1Char(Protocol::PayloadShared)));
+    }
+    return types;
 }
 
-void TcpClient::onDisconnected()
+// 握手：一条消息交换协议版本、负载上限、校验模式、压缩算法和负载类型，对端以protocol_hello回复选定的结果
+// 旧版对端没有对应的事件监听，会直接忽略，超时后改为逐项协商
+void TcpClient::sendHello()
 {
-    emit disconnected();
-    emit logMessage("已断开与服务器的连接");
-    
-    // 清空所有等待中的请求和接收缓冲区
-    m_pendingRequests.clear();
-    m_receiveBuffer.clear();
+    QJsonObject data;
+    data["version"] = Protocol::Version;
+    data["maxFrameSize"] = m_decoder.maxPayloadSize();
+    data["checksumModes"] = checksumModeOffer();
+    data["compressionCodecs"] = compressionCodecOffer();
+    data["threshold"] = m_encoding.compressionThreshold;
+    data["payloadTypes"] = localPayloadTypes();
+    QJsonObject request;
+    request["event"] = "protocol_hello";
+    request["data"] = data;
+
+    writeControlFrame(buildProtocolMessage(request));
+    m_helloTimer.start(kHelloTimeoutMs);
 }
 
-void TcpClient::onReadyRead()
+void TcpClient::onHelloTimeout()
 {
-    QByteArray data = m_socket.readAll();
-    processReceivedData(data);
+    if (m_state != ConnectionState::Connected) {
+        return;
+    }
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage("对端未回复握手，按旧版协议逐项协商");
+    }
+    sendChecksumNegotiation();
+    sendCompressionNegotiation();
+    sendPayloadTypes();
+    emit protocolNegotiated(negotiated());
 }
 
-void TcpClient::onError(QAbstractSocket::SocketError socketError)
+// 发送校验模式协商请求（旧版对端）
+// 该帧始终使用旧版格式，旧版对端没有对应的事件监听，会直接忽略，发送端保持SHA-256
+void TcpClient::sendChecksumNegotiation()
 {
-    Q_UNUSED(socketError);
-    QString errorMsg = m_socket.errorString();
-    emit error("连接错误: " + errorMsg);
-    emit logMessage("连接错误: " + errorMsg);
+    QJsonArray modes = checksumModeOffer();
+    if (modes.isEmpty()) {
+        return;
+    }
+
+    QJsonObject data;
+    data["modes"] = modes;
+    QJsonObject request;
+    request["event"] = "checksum_negotiate";
+    request["data"] = data;
+
+    m_encoding.checksum = Protocol::ChecksumMode::Sha256;
+    writeControlFrame(buildProtocolMessage(request));
 }
 
-void TcpClient::onTimeout()
+// 发送压缩算法协商请求，首选算法在前，对端选出双方都支持的一个
+// 旧版对端忽略该事件，双方都不压缩
+void TcpClient::sendCompressionNegotiation()
 {
-    QStringList timeoutIds;
-    
-    // 检查所有等待中的请求是否超时
-    QMutableMapIterator<QString, ResponseCallback> it(m_pendingRequests);
-    while (it.hasNext()) {
-        it.next();
-        
-        // 在实际应用中，可以为每个请求记录发送时间，这里简化处理
-        // 这里我们应该检查请求的发送时间，然后决定是否超时
-        // 由于这是示例，我们这里不做真正的超时处理
+    m_encoding.compression = Protocol::CompressionCodec::None;
+    QJsonArray codecs = compressionCodecOffer();
+    if (codecs.isEmpty()) {
+        return;
     }
+
+    QJsonObject data;
+    data["codecs"] = codecs;
+    data["threshold"] = m_encoding.compressionThreshold;
+    QJsonObject request;
+    request["event"] = "compression_negotiate";
+    request["data"] = data;
+
+    writeControlFrame(buildProtocolMessage(request));
+}
+
+// 告知对端本端能接收的二进制负载类型，旧版对端忽略该事件，继续只发送JSON
+void TcpClient::sendPayloadTypes()
+{
+    QJsonObject data;
+    data["types"] = localPayloadTypes();
+    QJsonObject request;
+    request["event"] = "payload_types";
+    request["data"] = data;
+
+    writeControlFrame(buildProtocolMessage(request));
+}
+
+void TcpClient::applyPeerChecksumMode(const QString &modeName)
+{
+    Protocol::ChecksumMode mode;
+    if (Protocol::checksumModeFromName(modeName, &mode)
+        && (mode == m_preferredChecksumMode || mode == Protocol::ChecksumMode::Sha256)) {
+        m_encoding.checksum = mode;
+        if (shouldLog(LogLevel::Info)) {
+            emit logMessage("校验模式协商完成: " + modeName);
+        }
+    } else if (shouldLog(LogLevel::Error)) {
+        emit logMessage("对端返回未知校验模式: " + modeName);
+    }
+}
+
+void TcpClient::applyPeerCompression(const QString &codecName)
+{
+    Protocol::CompressionCodec codec;
+    if (Compression::codecFromName(codecName, &codec) && Compression::isAvailable(codec)) {
+        m_encoding.compression = codec;
+        if (shouldLog(LogLevel::Info)) {
+            emit logMessage("压缩算法协商完成: " + codecName);
+        }
+    } else if (shouldLog(LogLevel::Error)) {
+        emit logMessage("对端返回未知压缩算法: " + codecName);
+    }
+}
+
+void TcpClient::applyPeerPayloadTypes(const QJsonArray &types)
+{
+    m_peerPayloadTypes.clear();
+    for (const QJsonValue &type : types) {
+        QString name = type.toString();
+        if (name.size() == 1) {
+            m_peerPayloadTypes.insert(name.at(0).toLatin1());
+        }
+    }
+}
+
+// 处理协议层消息，返回true表示已处理，不再向上分发
+bool TcpClient::handleProtocolMessage(const MessageView &message)
+{
+    const QByteArray &event = message.eventBytes();
+    if (event != "pong" && event != "protocol_hello" && event != "checksum_negotiate"
+        && event != "payload_types" && event != "compression_negotiate") {
+        return false;
+    }
+    QJsonObject data = message.object()["data"].toObject();
+
+    if (event == "pong") {
+        handlePong(data);
+        return true;
+    }
+
+    if (event == "protocol_hello") {
+        m_helloTimer.stop();
+        m_peerVersion = qBound(1, data["version"].toInt(1), Protocol::Version);
+        qint64 maxPayloadSize = static_cast<qint64>(data["maxFrameSize"].toDouble());
+        m_peerMaxPayloadSize = maxPayloadSize > 0 ? maxPayloadSize : Protocol::DefaultMaxPayloadSize;
+        // 对端写出回复后即开始加同步标记，本端从下一帧开始加
+        m_encoding.syncMarker = m_peerVersion >= Protocol::SyncMarkerVersion;
+        // 没有选中的项保持默认：SHA-256、不压缩
+        if (data.contains("checksum")) {
+            applyPeerChecksumMode(data["checksum"].toString());
+        }
+        if (data.contains("compression") && data["compression"].toString() != QLatin1String("none")) {
+            applyPeerCompression(data["compression"].toString());
+        }
+        applyPeerPayloadTypes(data["payloadTypes"].toArray());
+        if (shouldLog(LogLevel::Info)) {
+            emit logMessage(QString("协议握手完成: 版本%1，单帧上限%2字节")
+                            .arg(m_peerVersion).arg(m_peerMaxPayloadSize));
+        }
+        emit protocolNegotiated(negotiated());
+        startHeartbeat();
+        return true;
+    }
+
+    if (event == "checksum_negotiate") {
+        applyPeerChecksumMode(data["mode"].toString());
+        return true;
+    }
+
+    if (event == "payload_types") {
+        applyPeerPayloadTypes(data["types"].toArray());
+        return true;
+    }
+
+    if (event == "compression_negotiate") {
+        applyPeerCompression(data["codec"].toString());
+        return true;
+    }
+
+    return false;
+}
+
+// 构建协议消息
+EncodedFrame TcpClient::buildProtocolMessage(const QJsonObject &message)
+{
+    // 转换为JSON字符串
+    QJsonDocument doc(message);
+    QByteArray jsonData = doc.toJson(QJsonDocument::Compact);
+    
+    // 调试输出：打印JSON字符串
+    if (shouldLog(LogLevel::Frame)) {
+        emit logMessage("发送JSON: " + QString::fromUtf8(jsonData));
+    }
+    
+    return encodeFrame(jsonData, "只计算JSON数据");
+}
+
+// 直接构建协议消息（不使用JSON包装）
+EncodedFrame TcpClient::buildProtocolMessageDirect(const QByteArray &rawData)
+{
+    // 调试输出：打印原始数据
+    if (shouldLog(LogLevel::Frame)) {
+        emit logMessage("发送原始数据: " + QString::fromUtf8(rawData));
+    }
+    
+    return encodeFrame(rawData, "只计算原始数据");
+}
+
+// 编码一帧：[4字节长度][2字节类型][负载][4字节校验]
+// 负载与调用方共享，不拼接中间缓冲区
+EncodedFrame TcpClient::encodeFrame(const QByteArray &payload, const char *lengthNote)
+{
+    EncodedFrame frame = FrameEncoder::encode(Protocol::PayloadJson, m_encoding, payload);
+    logEncodedFrame(frame, lengthNote);
+    return frame;
+}
+
+// 构建二进制帧，二进制数据不做base64编码
+EncodedFrame TcpClient::buildBinaryMessage(char payloadType, const QJsonObject &meta, const QByteArray &data)
+{
+    QByteArray metaData = QJsonDocument(meta).toJson(QJsonDocument::Compact);
+    
+    if (shouldLog(LogLevel::Frame)) {
+        emit logMessage(QString("发送二进制负载 '%1': %2, %3 字节")
+                        .arg(QLatin1Char(payloadType))
+                        .arg(QString::fromUtf8(metaData))
+                        .arg(data.size()));
+    }
+    
+    EncodedFrame frame = FrameEncoder::encodeBinary(payloadType, m_encoding, metaData, data);
+    logEncodedFrame(frame, "元数据+二进制数据");
+    return frame;
+}
+
+void TcpClient::logEncodedFrame(const EncodedFrame &frame, const char *lengthNote)
+{
+    if (shouldLog(LogLevel::Hexdump)) {
+        int dumpLength = static_cast<int>(qMin<qint64>(frame.size(), m_hexdumpLimit));
+        QByteArray head(dumpLength, Qt::Uninitialized);
+        for (int i = 0; i < dumpLength; ++i) {
+            head[i] = frame.byteAt(i);
+        }
+        emit logMessage("发送二进制数据 (" + QString::number(frame.size()) + " 字节):\n"
+                        + formatHexDump(head, frame.size()));
+    }
+    
+    if (shouldLog(LogLevel::Frame)) {
+        emit logMessage(QString("长度头: %1 字节 (%2), 消息体长度: %3 字节, 压缩: %4, %5: 0x%6")
+                        .arg(frame.payloadSize())
+                        .arg(lengthNote)
+                        .arg(Protocol::TypeFieldSize + frame.payloadSize())
+                        .arg(Compression::codecName(frame.compression()))
+                        .arg(Protocol::checksumModeName(m_encoding.checksum))
+                        .arg(QString::number(frame.checksum(), 16).toUpper()));
+    }
+}
+
+// 发送一帧，写缓冲区中的普通消息不超过m_writeBudget时直接提交，否则在发送队列中等待写缓冲区空闲；
+// 达到高水位后按策略排队、丢弃或失败
+// firstRequestId/requestCount为该帧携带的请求（批量帧的请求ID连续），被丢弃时以错误结束
+bool TcpClient::writeFrame(const EncodedFrame &frame, SendPolicy policy,
+                           RequestId firstRequestId, int requestCount)
+{
+    if (m_sendQueue.isEmpty() && pendingWriteBytes() < m_writeBudget) {
+        submitFrame(frame);
+        checkHighWatermark();
+        return true;
+    }
+
+    if (!admitToQueue(frame.size(), policy, requestCount)) {
+        return false;
+    }
+
+    QueuedFrame queued;
+    queued.frame = frame;
+    queued.policy = policy;
+    queued.firstRequestId = firstRequestId;
+    queued.requestCount = requestCount;
+    m_sendQueue.append(queued);
+    m_queuedBytes += frame.size();
+    checkHighWatermark();
+    return true;
+}
+
+// 未达高水位时总是可以排队；达到高水位后FailFast直接失败，DropOldest先丢弃最早排队的DropOldest帧，
+// 仍超过队列上限时失败
+bool TcpClient::admitToQueue(qint64 bytes, SendPolicy policy, int requestCount)
+{
+    checkHighWatermark();
+    if (!m_writeBlocked) {
+        return true;
+    }
+
+    if (policy == SendPolicy::DropOldest) {
+        for (int i = 0; i < m_sendQueue.size() && backlogBytes() + bytes > m_maxQueuedBytes;) {
+            if (m_sendQueue[i].policy != SendPolicy::DropOldest) {
+                ++i;
+                continue;
+            }
+            QueuedFrame dropped = m_sendQueue.takeAt(i);
+            m_queuedBytes -= dropped.frame.size();
+            for (int n = 0; n < dropped.requestCount; ++n) {
+                ClientMetrics::add(m_metrics.dropped);
+                failPendingRequest(dropped.firstRequestId + n, "dropped", "发送队列已满，请求被丢弃");
+            }
+        }
+    }
+
+    if (policy == SendPolicy::FailFast || backlogBytes() + bytes > m_maxQueuedBytes) {
+        ClientMetrics::add(m_metrics.rejected, qMax(1, requestCount));
+        emit error("发送缓冲区已满");
+        return false;
+    }
+    return true;
+}
+
+// 未写出的数据达到高水位时发出writeBlocked
+void TcpClient::checkHighWatermark()
+{
+    if (!m_writeBlocked && pendingWriteBytes() + backlogBytes() >= m_highWatermark) {
+        m_writeBlocked = true;
+        emit writeBlocked();
+    }
+}
+
+bool TcpClient::writeFrame(const EncodedFrame &frame, const RequestOptions &options,
+                           RequestId firstRequestId, int requestCount)
+{
+    if (options.priority == MessagePriority::Control) {
+        writeControlFrame(frame);
+        return true;
+    }
+    return writeFrame(frame, options.sendPolicy, firstRequestId, requestCount);
+}
+
+// 控制消息（停止、暂停、心跳、握手）不进入发送队列，也不受高水位和队列上限限制，直接提交到写缓冲区：
+// 排在已排队的普通消息和分块流剩余的分块之前，只需等待已提交的数据写出
+void TcpClient::writeControlFrame(const EncodedFrame &frame)
+{
+    submitFrame(frame);
+    checkHighWatermark();
+}
+
+// 写入socket，头部、负载和校验尾部分段提交，负载只拷贝进写缓冲区一次
+// 开启合并写入时先追加到合并缓冲区，本轮事件循环结束后一次写出
+void TcpClient::submitFrame(const EncodedFrame &frame)
+{
+    if (m_coalesceWrites) {
+        ClientMetrics::add(m_metrics.framesSent);
+        ClientMetrics::add(m_metrics.bytesSent, frame.size() + (m_encoding.syncMarker ? Protocol::SyncMarkerSize : 0));
+        frame.appendTo(&m_writeBuffer, m_encoding.syncMarker);
+        if (!m_flushScheduled) {
+            m_flushScheduled = true;
+            QTimer::singleShot(0, this, &TcpClient::flushWrites);
+        }
+        return;
+    }
+
+    ClientMetrics::add(m_metrics.framesSent);
+    ClientMetrics::add(m_metrics.bytesSent, frame.size() + (m_encoding.syncMarker ? Protocol::SyncMarkerSize : 0));
+    if (frame.writeTo(m_transport->device(), m_encoding.syncMarker) < 0) {
+        if (shouldLog(LogLevel::Error)) {
+            emit logMessage("写入socket失败: " + m_transport->errorString());
+        }
+    }
+}
+
+void TcpClient::flushWrites()
+{
+    m_flushScheduled = false;
+    if (m_writeBuffer.isEmpty()) {
+        return;
+    }
+    if (m_transport->device()->write(m_writeBuffer) != m_writeBuffer.size()) {
+        if (shouldLog(LogLevel::Error)) {
+            emit logMessage("写入socket失败: " + m_transport->errorString());
+        }
+    }
+    m_writeBuffer.clear();
+}
+
+// 写缓冲区有空闲时把排队的帧提交到socket，未写出的数据降到低水位后发出writeReady
+void TcpClient::drainSendQueue()
+{
+    while (!m_sendQueue.isEmpty() && pendingWriteBytes() < m_writeBudget) {
+        QueuedFrame queued = m_sendQueue.takeFirst();
+        m_queuedBytes -= queued.frame.size();
+        submitFrame(queued.frame);
+    }
+    if (m_writeBlocked && pendingWriteBytes() + backlogBytes() <= m_lowWatermark) {
+        m_writeBlocked = false;
+        emit writeReady();
+    }
+}
+
+void TcpClient::onBytesWritten()
+{
+    drainSendQueue();
+    pumpStreams();
+}
+
+void TcpClient::setWriteWatermarks(qint64 high, qint64 low)
+{
+    m_highWatermark = qMax<qint64>(1, high);
+    m_lowWatermark = qBound<qint64>(0, low, m_highWatermark);
+}
+
+void TcpClient::setSendQueueLimit(qint64 bytes)
+{
+    m_maxQueuedBytes = qMax<qint64>(0, bytes);
+}
+
+void TcpClient::setWriteBudget(qint64 bytes)
+{
+    m_writeBudget = qMax<qint64>(1, bytes);
+}
+
+bool TcpClient::isWriteBlocked() const
+{
+    return m_writeBlocked;
+}
+
+qint64 TcpClient::queuedBytes() const
+{
+    return m_queuedBytes;
+}
+
+// 已提交但尚未写入内核的字节数，包括合并缓冲区中的数据
+qint64 TcpClient::pendingWriteBytes() const
+{
+    return (m_transport ? m_transport->bytesToWrite() : 0) + m_writeBuffer.size();
+}
+
+// 还没有提交到写缓冲区的字节数：发送队列和分块流中尚未发出的部分
+qint64 TcpClient::backlogBytes() const
+{
+    return m_queuedBytes + m_streamBytes;
+}
+
+// 处理接收到的数据（黏包处理）
+// 帧在解码器缓冲区内原地解析，JSON直接从缓冲区视图解析，不再逐帧拷贝和移动缓冲区
+void TcpClient::processReceivedData()
+{
+    FrameView frame;
+    while (m_decoder.nextFrame(&frame)) {
+        ClientMetrics::add(m_metrics.framesReceived);
+        if (shouldLog(LogLevel::Frame)) {
+            emit logMessage(QString("收到消息长度: %1, 消息体长度: %2, 压缩: %3, 接收CRC: 0x%4, 计算CRC: 0x%5")
+                            .arg(frame.wireLength)
+                            .arg(Protocol::TypeFieldSize + frame.wireLength)
+                            .arg(Compression::codecName(frame.compression))
+                            .arg(QString::number(frame.receivedChecksum, 16).toUpper())
+                            .arg(QString::number(frame.calculatedChecksum, 16).toUpper()));
+        }
+        if (shouldLog(LogLevel::Hexdump)) {
+            int dumpLength = qMin(frame.payloadLength, m_hexdumpLimit);
+            emit logMessage("接收负载:\n" + formatHexDump(QByteArray::fromRawData(frame.payload, dumpLength),
+                                                           frame.payloadLength));
+        }
+
+        if (!frame.checksumValid) {
+            ClientMetrics::add(m_metrics.checksumFailures);
+            if (shouldLog(LogLevel::Error)) {
+                emit logMessage("CRC验证失败，丢弃消息");
+            }
+            continue;
+        }
+        if (frame.decompressionFailed) {
+            ClientMetrics::add(m_metrics.decompressionFailures);
+            if (shouldLog(LogLevel::Error)) {
+                emit logMessage("解压失败，丢弃消息");
+            }
+            continue;
+        }
+
+        // CRC验证通过，按类型字段分发
+        if (frame.payloadType == Protocol::PayloadJson) {
+            dispatchJsonMessage(frame.payloadBytes());
+        } else if (frame.payloadType == Protocol::PayloadBatch) {
+            dispatchBatchFrame(frame);
+        } else if (frame.payloadType == Protocol::PayloadChunk) {
+            dispatchChunkFrame(frame);
+        } else if (frame.payloadType == Protocol::PayloadShared) {
+            dispatchSharedFrame(frame);
+        } else if (m_payloadHandlers.contains(frame.payloadType)) {
+            dispatchBinaryFrame(frame);
+        } else if (shouldLog(LogLevel::Error)) {
+            emit logMessage(QString("未注册的负载类型 0x%1，丢弃消息")
+                            .arg(static_cast<quint8>(frame.payloadType), 2, 16, QChar('0')));
+        }
+        // 回调中断开连接后解码器已清空，frame指向的缓冲区可能已释放
+        if (!isConnected()) {
+            break;
+        }
+    }
+
+    qint64 discarded = m_decoder.takeDiscardedBytes();
+    if (discarded > 0) {
+        ClientMetrics::add(m_metrics.discardedBytes, static_cast<quint64>(discarded));
+        if (shouldLog(LogLevel::Error)) {
+            emit logMessage(QString("数据流失步，跳过 %1 字节后重新同步").arg(discarded));
+        }
+    }
+    // 旧版帧没有同步标记，长度异常后无法定位下一帧，断开后由自动重连恢复
+    if (m_decoder.isBroken() && isConnected()) {
+        if (shouldLog(LogLevel::Error)) {
+            emit logMessage(QString("帧长度超过上限 %1 字节，断开连接").arg(m_decoder.maxPayloadSize()));
+        }
+        emit error("数据流损坏：帧长度超过上限");
+        m_transport->abort();
+    }
+}
+
+// JSON直接从缓冲区视图解析
+void TcpClient::dispatchJsonMessage(const QByteArray &jsonData)
+{
+    if (shouldLog(LogLevel::Frame)) {
+        emit logMessage("接收JSON: " + QString::fromUtf8(jsonData));
+    }
+
+    // 先只取路由字段，有回调或订阅者时才完整解析
+    MessageView message(jsonData);
+    if (!message.isValid()) {
+        reportParseFailure("解析响应失败");
+        return;
+    }
+
+    // 协议层消息不向上分发
+    if (handleProtocolMessage(message)) {
+        return;
+    }
+
+    // 检查是否有请求ID，不是请求的响应时按推送事件分发
+    ResponseCallback callback = message.hasRequestId() ? takePendingCallback(message.requestId())
+                                                       : ResponseCallback();
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage((callback ? "收到响应: " : "收到事件: ") + message.event());
+    }
+    if (!callback) {
+        dispatchEvent(message);
+        return;
+    }
+    // 回调已从等待表取出，解析失败时也要以错误响应结束，否则对应的Reply永远不会完成
+    if (message.parseFailed()) {
+        reportParseFailure("解析响应失败");
+        callback(makeErrorResponse(message.requestId(), "parse_error", "解析响应失败"));
+        return;
+    }
+    callback(message.object());
+}
+
+// 批量帧：逐条按JSON消息分发
+void TcpClient::dispatchBatchFrame(const FrameView &frame)
+{
+    QList<QByteArray> messages;
+    if (!splitBatchPayload(frame, &messages)) {
+        reportParseFailure("解析批量消息失败");
+        return;
+    }
+    for (const QByteArray &message : messages) {
+        // 回调中断开连接后缓冲区可能已释放，剩余消息不再处理
+        if (!isConnected()) {
+            break;
+        }
+        dispatchJsonMessage(message);
+    }
+}
+
+// 二进制帧：元数据按JSON解析，二进制数据以视图形式交给注册的处理函数
+void TcpClient::dispatchBinaryFrame(const FrameView &frame)
+{
+    BinaryPayloadView payload;
+    QJsonDocument metaDoc;
+    if (splitBinaryPayload(frame, &payload)) {
+        metaDoc = QJsonDocument::fromJson(payload.meta);
+    }
+    if (!metaDoc.isObject()) {
+        reportParseFailure("解析二进制消息元数据失败");
+        return;
+    }
+
+    QJsonObject meta = metaDoc.object();
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage(QString("收到二进制消息: %1, %2 字节")
+                        .arg(meta["event"].toString())
+                        .arg(payload.data.size()));
+    }
+
+    // 复制一份处理函数，处理函数内可以重新注册
+    PayloadHandler handler = m_payloadHandlers.value(frame.payloadType);
+    if (handler) {
+        handler(meta, payload.data);
+        // 处理函数中断开连接后等待表已清空，不再解析响应
+        if (!isConnected()) {
+            return;
+        }
+    }
+    recordPayloadLatency(meta);
+
+    // 带请求ID的二进制响应，回调收到元数据，二进制数据通过处理函数获取
+    resolvePendingRequest(meta);
+}
+
+// 分块帧：有流处理函数时逐段回调，否则拼接完整后按二进制负载分发
+void TcpClient::dispatchChunkFrame(const FrameView &frame)
+{
+    ChunkView chunk;
+    if (!splitChunkPayload(frame, &chunk)) {
+        reportParseFailure("解析分块消息失败");
+        return;
+    }
+
+    auto it = m_incomingStreams.find(chunk.streamId);
+    if (chunk.sequence == 0) {
+        QJsonDocument metaDoc = QJsonDocument::fromJson(chunk.meta);
+        if (!metaDoc.isObject()) {
+            reportParseFailure("解析分块消息元数据失败");
+            return;
+        }
+        IncomingStream stream;
+        stream.meta = metaDoc.object();
+        QString type = stream.meta["type"].toString();
+        stream.payloadType = type.size() == 1 ? type.at(0).toLatin1() : Protocol::PayloadBinary;
+        stream.nextSequence = 0;
+        stream.received = 0;
+        it = m_incomingStreams.insert(chunk.streamId, stream);
+    } else if (it == m_incomingStreams.end() || it->nextSequence != chunk.sequence) {
+        // 序号不连续，丢弃整个流
+        if (it != m_incomingStreams.end()) {
+            m_incomingStreams.erase(it);
+        }
+        if (shouldLog(LogLevel::Error)) {
+            emit logMessage(QString("分块序号不连续，丢弃流 %1").arg(chunk.streamId));
+        }
+        return;
+    }
+
+    StreamChunk piece;
+    piece.streamId = chunk.streamId;
+    piece.payloadType = it->payloadType;
+    piece.meta = it->meta;
+    piece.data = chunk.data;
+    piece.offset = it->received;
+    piece.final = chunk.final;
+    it->nextSequence++;
+    it->received += chunk.data.size();
+
+    StreamHandler handler = m_streamHandlers.value(piece.meta["event"].toString());
+    if (!handler) {
+        if (it->received > kMaxStreamSize) {
+            m_incomingStreams.erase(it);
+            if (shouldLog(LogLevel::Error)) {
+                emit logMessage(QString("分块流超过上限，丢弃流 %1").arg(chunk.streamId));
+            }
+            return;
+        }
+        it->buffer.append(chunk.data);
+    }
+    if (!chunk.final) {
+        if (handler) {
+            handler(piece);
+        }
+        return;
+    }
+
+    // 最后一个分块，先移出流表，处理函数内可以安全地发起新请求
+    IncomingStream stream = m_incomingStreams.take(chunk.streamId);
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage(QString("收到分块消息: %1, %2 字节, %3 块")
+                        .arg(stream.meta["event"].toString())
+                        .arg(stream.received)
+                        .arg(stream.nextSequence));
+    }
+    if (handler) {
+        handler(piece);
+    } else {
+        PayloadHandler payloadHandler = m_payloadHandlers.value(stream.payloadType);
+        if (payloadHandler) {
+            payloadHandler(stream.meta, stream.buffer);
+        }
+    }
+    // 处理函数中断开连接后piece指向的缓冲区可能已释放，等待表也已清空
+    if (!isConnected()) {
+        return;
+    }
+    recordPayloadLatency(stream.meta);
+    resolvePendingRequest(stream.meta);
+}
+
+// 共享内存描述符帧：数据直接从共享内存交给处理函数，与完整的二进制帧或分块流一样分发，处理完后释放空间
+void TcpClient::dispatchSharedFrame(const FrameView &frame)
+{
+    BinaryPayloadView payload;
+    if (!splitBinaryPayload(frame, &payload) || payload.data.size() != Protocol::SharedDescriptorSize) {
+        reportParseFailure("解析共享内存描述符失败");
+        return;
+    }
+    const char *descriptor = payload.data.constData();
+    char payloadType = descriptor[0];
+    quint32 position = Protocol::readUInt32BE(descriptor + 1);
+    quint32 length = Protocol::readUInt32BE(descriptor + 5);
+    QJsonDocument metaDoc = QJsonDocument::fromJson(payload.meta);
+    QByteArray data;
+    bool valid = m_sharedRing && m_sharedRing->view(position, length, &data);
+    if (!metaDoc.isObject() || !valid) {
+        // 不处理的数据也要越过，否则写端的空间收不回来；能确定请求ID时以错误响应结束等待中的请求
+        if (m_sharedRing) {
+            m_sharedRing->discard(position, length);
+        }
+        if (!metaDoc.isObject()) {
+            reportParseFailure("解析共享内存描述符失败");
+            return;
+        }
+        emit error("共享内存描述符无效");
+        QJsonValue requestId = metaDoc.object()["requestId"];
+        if (requestId.isDouble()) {
+            failPendingRequest(static_cast<RequestId>(requestId.toDouble()), "invalid_payload", "共享内存描述符无效");
+        }
+        return;
+    }
+
+    QJsonObject meta = metaDoc.object();
+    ClientMetrics::add(m_metrics.sharedPayloads);
+    ClientMetrics::add(m_metrics.sharedBytes, length);
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage(QString("收到共享内存消息: %1, %2 字节")
+                        .arg(meta["event"].toString())
+                        .arg(length));
+    }
+
+    StreamHandler streamHandler = m_streamHandlers.value(meta["event"].toString());
+    if (streamHandler) {
+        StreamChunk piece;
+        piece.payloadType = payloadType;
+        piece.meta = meta;
+        piece.data = data;
+        piece.final = true;
+        streamHandler(piece);
+    } else {
+        PayloadHandler handler = m_payloadHandlers.value(payloadType);
+        if (handler) {
+            handler(meta, data);
+        }
+    }
+    // 处理函数中断开连接时不再释放，对端在新连接接管共享内存时重置
+    if (!isConnected()) {
+        return;
+    }
+    // 处理函数需要保留数据时已自行拷贝
+    m_sharedRing->release(position + length);
+    recordPayloadLatency(meta);
+    resolvePendingRequest(meta);
+}
+
+// 对端在元数据中带上发出时间（毫秒时间戳）时，记录到处理完为止的耗时
+void TcpClient::recordPayloadLatency(const QJsonObject &meta)
+{
+    QJsonValue sentAt = meta["sentAt"];
+    if (sentAt.isDouble()) {
+        m_metrics.lastPayloadLatencyMs.store(QDateTime::currentMSecsSinceEpoch() - static_cast<qint64>(sentAt.toDouble()),
+                                             std::memory_order_relaxed);
+    }
+}
+
+// 记录等待响应的请求，超时由时间轮负责
+void TcpClient::addPendingRequest(RequestId requestId, ResponseCallback callback, int timeoutMs,
+                                  const QString &event)
+{
+    if (!callback) {
+        return;
+    }
+    // 发送时刻和事件分类随回调存放，收到响应时计入该事件的耗时直方图
+    m_pendingRequests.insert(requestId, std::move(callback), m_clock.nsecsElapsed() / 1000,
+                             m_metrics.latencyIndex(event));
+    m_metrics.pendingRequests.store(m_pendingRequests.size(), std::memory_order_relaxed);
+    ClientMetrics::add(m_metrics.requestsSent);
+    if (timeoutMs > 0) {
+        m_deadlines.schedule(requestId, timeoutMs);
+        if (!m_timeoutTimer.isActive()) {
+            m_timeoutTimer.start();
+        }
+    }
+}
+
+bool TcpClient::resolvePendingRequest(const QJsonObject &response)
+{
+    // 请求ID在线上是整数，字符串ID（旧版）不会匹配到任何请求
+    QJsonValue idValue = response["requestId"];
+    if (!idValue.isDouble()) {
+        return false;
+    }
+    ResponseCallback callback = takePendingCallback(static_cast<RequestId>(idValue.toDouble()));
+    if (callback) {
+        callback(response);
+        return true;
+    }
+    return false;
+}
+
+// 查找对应的回调，先从等待列表中移除，回调内可以安全地发起新请求
+ResponseCallback TcpClient::takePendingCallback(RequestId requestId)
+{
+    qint64 sentAt = 0;
+    int latencyIndex = -1;
+    ResponseCallback callback = m_pendingRequests.take(requestId, &sentAt, &latencyIndex);
+    if (callback) {
+        m_metrics.pendingRequests.store(m_pendingRequests.size(), std::memory_order_relaxed);
+        ClientMetrics::add(m_metrics.responsesReceived);
+        m_metrics.recordLatency(latencyIndex, m_clock.nsecsElapsed() / 1000 - sentAt);
+        if (!m_replayable.isEmpty()) {
+            m_replayable.remove(requestId);
+        }
+    }
+    return callback;
+}
+
+SubscriptionId TcpClient::on(const QString &event, EventHandler handler, QObject *context)
+{
+    QByteArray name = event.toUtf8();
+    auto it = m_eventIds.constFind(name);
+    int eventId;
+    if (it != m_eventIds.constEnd()) {
+        eventId = it.value();
+    } else {
+        eventId = m_eventSubscriptions.size();
+        m_eventIds.insert(name, eventId);
+        m_eventSubscriptions.append(QVector<Subscription>());
+    }
+    SubscriptionId id = m_nextSubscriptionId++;
+    m_eventSubscriptions[eventId].append({id, std::move(handler), context != nullptr, context});
+    return id;
+}
+
+SubscriptionId TcpClient::onAny(EventHandler handler, QObject *context)
+{
+    SubscriptionId id = m_nextSubscriptionId++;
+    m_anySubscriptions.append({id, std::move(handler), context != nullptr, context});
+    return id;
+}
+
+void TcpClient::off(SubscriptionId id)
+{
+    auto matches = [id](const Subscription &subscription) { return subscription.id == id; };
+    m_anySubscriptions.erase(std::remove_if(m_anySubscriptions.begin(), m_anySubscriptions.end(), matches),
+                             m_anySubscriptions.end());
+    for (QVector<Subscription> &subscriptions : m_eventSubscriptions) {
+        subscriptions.erase(std::remove_if(subscriptions.begin(), subscriptions.end(), matches),
+                            subscriptions.end());
+    }
+}
+
+// 推送事件：先调用按事件名订阅的处理函数，再调用onAny的处理函数；没有订阅者时不做完整解析
+// 复制一份订阅列表（隐式共享，不拷贝元素），处理函数内可以订阅和取消订阅
+void TcpClient::dispatchEvent(const MessageView &message)
+{
+    int eventId = m_eventIds.value(message.eventBytes(), -1);
+    const QVector<Subscription> subscriptions = eventId >= 0 ? m_eventSubscriptions.at(eventId)
+                                                             : QVector<Subscription>();
+    const QVector<Subscription> anySubscriptions = m_anySubscriptions;
+    if (subscriptions.isEmpty() && anySubscriptions.isEmpty()) {
+        return;
+    }
+    if (message.parseFailed()) {
+        reportParseFailure("解析响应失败");
+        return;
+    }
+    for (const Subscription &subscription : subscriptions) {
+        invokeSubscription(subscription, message.object());
+    }
+    for (const Subscription &subscription : anySubscriptions) {
+        invokeSubscription(subscription, message.object());
+    }
+}
+
+void TcpClient::invokeSubscription(const Subscription &subscription, const QJsonObject &message)
+{
+    if (!subscription.hasContext) {
+        subscription.handler(message);
+        return;
+    }
+    QObject *context = subscription.context.data();
+    if (!context) {
+        return;
+    }
+    if (context->thread() == QThread::currentThread()) {
+        subscription.handler(message);
+        return;
+    }
+    // context在其他线程，排队到它的事件循环；context先销毁时事件随之丢弃
+    EventHandler handler = subscription.handler;
+    QMetaObject::invokeMethod(context, [handler, message]() { handler(message); }, Qt::QueuedConnection);
+}
+
+// 轮流从各个流取一个分块写入socket，写缓冲区中积压的数据不超过一个分块，
+// 之后发送的消息最多排在一个分块后面；其余分块在bytesWritten后继续发送
+// 写缓冲区不足一个分块（且未超过普通消息的上限）时写出下一块，分块不会进入发送队列
+void TcpClient::pumpStreams()
+{
+    while (!m_outgoingStreams.isEmpty() && isConnected() && m_sendQueue.isEmpty()
+           && pendingWriteBytes() < qMin<qint64>(m_chunkSize, m_writeBudget)) {
+        OutgoingStream stream = m_outgoingStreams.takeFirst();
+        int remaining = static_cast<int>(stream.data.size()) - stream.offset;
+        int length = qMin(m_chunkSize, remaining);
+        bool final = length == remaining;
+        // 分块数据直接引用流的数据，写入socket时才拷贝
+        QByteArray data = QByteArray::fromRawData(stream.data.constData() + stream.offset, length);
+        EncodedFrame frame = FrameEncoder::encodeChunk(m_encoding, stream.id, stream.sequence, final,
+                                                       stream.meta, data);
+        logEncodedFrame(frame, "分块头+分块数据");
+        m_streamBytes -= length;
+        writeFrame(frame, stream.policy, stream.requestId);
+        if (!final) {
+            stream.offset += length;
+            stream.sequence++;
+            m_outgoingStreams.append(stream);
+        }
+    }
+}
+
+void TcpClient::onConnected()
+{
+    m_connectTimer.stop();
+    m_reconnectAttempt = 0;
+    if (m_reconnectClock.isValid()) {
+        ClientMetrics::add(m_metrics.reconnects);
+        qint64 reconnectMs = m_reconnectClock.elapsed();
+        m_metrics.lastReconnectMs.store(reconnectMs, std::memory_order_relaxed);
+        m_reconnectClock.invalidate();
+        if (shouldLog(LogLevel::Info)) {
+            emit logMessage(QString("重连成功，耗时%1ms").arg(reconnectMs));
+        }
+    }
+    setState(ConnectionState::Connected);
+    
+    emit connected();
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage("已连接到服务器");
+    }
+    sendHello();
+    replayPendingRequests();
+}
+
+void TcpClient::onDisconnected()
+{
+    m_connectTimer.stop();
+    emit disconnected();
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage("已断开与服务器的连接");
+    }
+    
+    resetTransport();
+    if (reconnectEnabled()) {
+        // 可重发的请求保留到重连之后，其余请求以错误结束
+        failAllPendingRequests(true);
+        m_reconnectClock.start();
+        m_reconnectAttempt = 0;
+        scheduleReconnect();
+    } else {
+        setState(ConnectionState::Disconnected);
+        failAllPendingRequests(false);
+    }
+}
+
+// 清空上一个连接的发送、接收缓冲区和协商结果
+void TcpClient::resetTransport()
+{
+    m_writeBuffer.clear();
+    m_sendQueue.clear();
+    m_queuedBytes = 0;
+    m_writeBlocked = false;
+    m_decoder.clear();
+    m_outgoingStreams.clear();
+    m_streamBytes = 0;
+    m_incomingStreams.clear();
+    m_peerPayloadTypes.clear();
+    m_peerVersion = 0;
+    m_peerMaxPayloadSize = Protocol::DefaultMaxPayloadSize;
+    m_helloTimer.stop();
+    m_heartbeatTimer.stop();
+    m_outstandingPings = 0;
+    m_peerUnresponsive = false;
+    m_encoding.checksum = Protocol::ChecksumMode::Sha256;
+    m_encoding.compression = Protocol::CompressionCodec::None;
+    m_encoding.syncMarker = false;
+}
+
+void TcpClient::startConnect()
+{
+    setState(ConnectionState::Connecting);
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage("正在连接 " + m_transport->description());
+    }
+    m_transport->open();
+    m_connectTimer.start(kConnectTimeoutMs);
+}
+
+void TcpClient::onConnectTimeout()
+{
+    if (m_state != ConnectionState::Connecting) {
+        return;
+    }
+    m_transport->abort();
+    handleConnectFailure("连接超时");
+}
+
+// 连接失败：开启自动重连时退避后重试，否则结束
+void TcpClient::handleConnectFailure(const QString &reason)
+{
+    if (reconnectEnabled()) {
+        if (shouldLog(LogLevel::Error)) {
+            emit logMessage("连接失败: " + reason);
+        }
+        scheduleReconnect();
+        return;
+    }
+    
+    m_reconnectWanted = false;
+    m_reconnectClock.invalidate();
+    setState(ConnectionState::Disconnected);
+    failAllPendingRequests(false);
+    emit error("连接服务器失败: " + reason);
+}
+
+// 带抖动的指数退避：d = initial * 2^attempt（不超过max），实际等待[d/2, d]
+void TcpClient::scheduleReconnect()
+{
+    qint64 delay = m_reconnectInitialDelay;
+    for (int i = 0; i < m_reconnectAttempt && delay < m_reconnectMaxDelay; ++i) {
+        delay *= 2;
+    }
+    int half = static_cast<int>(qMin<qint64>(delay, m_reconnectMaxDelay) / 2);
+    int delayMs = half + QRandomGenerator::global()->bounded(half + 1);
+    ++m_reconnectAttempt;
+    
+    setState(ConnectionState::Reconnecting);
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage(QString("%1ms后第%2次重连").arg(delayMs).arg(m_reconnectAttempt));
+    }
+    m_reconnectTimer.start(delayMs);
+}
+
+void TcpClient::setState(ConnectionState state)
+{
+    if (m_state == state) {
+        return;
+    }
+    m_state = state;
+    emit stateChanged(state);
+}
+
+void TcpClient::onReadyRead()
+{
+    // 直接读入解码缓冲区，整批解析完后最多移动一次剩余数据
+    qint64 received = m_decoder.readFrom(m_transport->device());
+    if (received > 0) {
+        ClientMetrics::add(m_metrics.bytesReceived, received);
+    }
+    processReceivedData();
+    m_decoder.compact();
+}
+
+void TcpClient::onError()
+{
+    QString errorMsg = m_transport->errorString();
+    if (shouldLog(LogLevel::Error)) {
+        emit logMessage("连接错误: " + errorMsg);
+    }
+    
+    if (m_state == ConnectionState::Connecting) {
+        m_connectTimer.stop();
+        handleConnectFailure(errorMsg);
+        return;
+    }
+    // 开启自动重连时连接断开不算错误，随后的disconnected会触发重连
+    if (!reconnectEnabled()) {
+        emit error("连接错误: " + errorMsg);
+    }
+}
+
+// 推进时间轮，到期且仍在等待的请求以错误响应结束；已响应的请求在这里被惰性丢弃
+void TcpClient::onTimeout()
+{
+    QVector<RequestId> expired;
+    m_deadlines.advance(&expired);
+    if (m_deadlines.isEmpty()) {
+        m_timeoutTimer.stop();
+    }
+
+    for (RequestId requestId : expired) {
+        if (!m_pendingRequests.contains(requestId)) {
+            continue;
+        }
+        ClientMetrics::add(m_metrics.timeouts);
+        if (shouldLog(LogLevel::Error)) {
+            emit logMessage("请求超时: " + QString::number(requestId));
+        }
+        failPendingRequest(requestId, "timeout", "请求超时");
+    }
+}
+
+// 以错误响应结束一个等待中的请求
+void TcpClient::failPendingRequest(RequestId requestId, const QString &code, const QString &message)
+{
+    ResponseCallback callback = m_pendingRequests.take(requestId);
+    if (!callback) {
+        return;
+    }
+    m_metrics.pendingRequests.store(m_pendingRequests.size(), std::memory_order_relaxed);
+    if (!m_replayable.isEmpty()) {
+        m_replayable.remove(requestId);
+    }
+
+    callback(makeErrorResponse(requestId, code, message));
+}
+
+// 取消等待中的请求
+// 还在发送队列中或分块流还没发出第一块时直接撤回，对端不知道这个请求；否则发送cancel_request通知对端停止处理
+bool TcpClient::cancel(RequestId requestId)
+{
+    if (!m_pendingRequests.contains(requestId)) {
+        return false;
+    }
+
+    bool peerHasRequest = true;
+    for (int i = 0; i < m_sendQueue.size(); ++i) {
+        const QueuedFrame &queued = m_sendQueue.at(i);
+        if (queued.firstRequestId == requestId && queued.requestCount == 1) {
+            m_queuedBytes -= queued.frame.size();
+            m_sendQueue.removeAt(i);
+            peerHasRequest = false;
+            break;
+        }
+    }
+    for (int i = 0; i < m_outgoingStreams.size(); ++i) {
+        if (m_outgoingStreams.at(i).requestId == requestId) {
+            peerHasRequest = m_outgoingStreams.at(i).sequence > 0;
+            m_streamBytes -= m_outgoingStreams.at(i).data.size() - m_outgoingStreams.at(i).offset;
+            m_outgoingStreams.removeAt(i);
+            break;
+        }
+    }
+
+    // 控制消息，不排在其他请求后面；对端同时丢弃该请求未收完的分块流
+    if (peerHasRequest && isConnected()) {
+        QJsonObject data;
+        data["requestId"] = static_cast<qint64>(requestId);
+        QJsonObject request;
+        request["event"] = "cancel_request";
+        request["data"] = data;
+        writeControlFrame(buildProtocolMessage(request));
+    }
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage("取消请求: " + QString::number(requestId));
+    }
+
+    ClientMetrics::add(m_metrics.cancelled);
+    failPendingRequest(requestId, "cancelled", "请求已取消");
+    return true;
+}
+
+// 连接断开时以错误结束等待中的请求，keepReplayable为true时保留可重发的请求
+void TcpClient::failAllPendingRequests(bool keepReplayable)
+{
+    for (RequestId requestId : m_pendingRequests.ids()) {
+        if (keepReplayable && m_replayable.contains(requestId)) {
+            continue;
+        }
+        failPendingRequest(requestId, "disconnected", "连接已断开");
+    }
+    if (m_pendingRequests.isEmpty()) {
+        m_deadlines.clear();
+        m_timeoutTimer.stop();
+    }
+}
+
+void TcpClient::rememberForReplay(RequestId requestId, char payloadType, const QJsonObject &message,
+                                  const QByteArray &data)
+{
+    ReplayableRequest request;
+    request.payloadType = payloadType;
+    request.message = message;
+    request.data = data;
+    m_replayable.insert(requestId, request);
+}
+
+// 重连后按原请求ID顺序重新发送，截止时间不变
+void TcpClient::replayPendingRequests()
+{
+    if (m_replayable.isEmpty()) {
+        return;
+    }
+    QVector<RequestId> requestIds;
+    requestIds.reserve(m_replayable.size());
+    for (auto it = m_replayable.constBegin(); it != m_replayable.constEnd(); ++it) {
+        requestIds.append(it.key());
+    }
+    std::sort(requestIds.begin(), requestIds.end());
+    
+    for (RequestId requestId : requestIds) {
+        // 前面请求的错误回调可能已经结束了其他请求
+        auto it = m_replayable.constFind(requestId);
+        if (it == m_replayable.constEnd()) {
+            continue;
+        }
+        EncodedFrame frame;
+        if (it->payloadType != Protocol::PayloadJson) {
+            frame = buildBinaryMessage(it->payloadType, it->message, it->data);
+        } else if (!it->data.isEmpty()) {
+            frame = buildProtocolMessageDirect(it->data);
+        } else {
+            frame = buildProtocolMessage(it->message);
+        }
+        if (!writeFrame(frame, SendPolicy::Wait, requestId)) {
+            failPendingRequest(requestId, "rejected", "发送缓冲区已满");
+            continue;
+        }
+        ClientMetrics::add(m_metrics.replayed);
+    }
+    if (shouldLog(LogLevel::Info)) {
+        emit logMessage(QString("重新发送 %1 个请求").arg(requestIds.size()));
+    }
+}
+
+ClientStats TcpClient::stats() const
+{
+    return m_metrics.snapshot(false);
+}
+
+ClientStats TcpClient::resetStats()
+{
+    return m_metrics.snapshot(true);
+}
+
+// 解析失败的消息计入统计后报告错误
+void TcpClient::reportParseFailure(const QString &message)
+{
+    ClientMetrics::add(m_metrics.parseFailures);
+    emit error(message);
 } 
\ No newline at end of file
@@ -2,69 +2,505 @@
 #define TCPCLIENT_H
 
 #include <QObject>
-#include <QTcpSocket>
 #include <QJsonObject>
 #include <QJsonDocument>
-#include <QUuid>
-#include <QMap>
+#include <QJsonArray>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QVector>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
 #include <functional>
+#include <atomic>
+#include "protocol.h"
+#include "framecodec.h"
+#include "timerwheel.h"
+#include "pendingrequesttable.h"
+#include "transport.h"
+#include "sharedring.h"
+#include "reply.h"
+#include "messageschema.h"
+#include "clientmetrics.h"
 
-// 定义回调函数类型
-using ResponseCallback = std::function<void(const QJsonObject&)>;
+class MessageView;
+
+// 二进制负载处理函数，data指向接收缓冲区或共享内存，只在调用期间有效
+using PayloadHandler = std::function<void(const QJsonObject &meta, const QByteArray &data)>;
+
+// 分块流中的一段，data指向接收缓冲区，只在调用期间有效
+struct StreamChunk
+{
+    quint32 streamId = 0;
+    char payloadType = Protocol::PayloadBinary;
+    QJsonObject meta;   // 整个流的元数据，每段都相同
+    QByteArray data;
+    qint64 offset = 0;  // 本段在整个流中的偏移
+    bool final = false;
+};
+using StreamHandler = std::function<void(const StreamChunk &chunk)>;
+
+// 服务器推送事件的处理函数，message是完整的消息（event、data）
+using EventHandler = std::function<void(const QJsonObject &message)>;
+// 订阅ID，0表示无效
+using SubscriptionId = quint64;
+
+// 发送缓冲区达到高水位后新消息的处理方式
+enum class SendPolicy {
+    Wait,       // 进入发送队列，缓冲区降到低水位后发送；队列满时失败
+    FailFast,   // 直接失败
+    DropOldest  // 进入发送队列，队列满时丢弃最早排队的DropOldest消息，被丢弃的请求回调收到错误响应
+};
+
+// 发送优先级
+enum class MessagePriority {
+    Normal,  // 写缓冲区达到高水位后按SendPolicy排队
+    Control  // 不进入发送队列，直接提交到写缓冲区，排在已排队的消息和分块流剩余的分块之前
+};
+
+// 单个请求的选项
+struct RequestOptions
+{
+    // 超时时间，到期未收到响应时回调收到错误响应；<=0表示不超时
+    int timeoutMs = 5000;
+    SendPolicy sendPolicy = SendPolicy::Wait;
+    // 可安全重发：连接意外断开时仍在等待的请求，自动重连后以相同ID重新发送；
+    // 其余请求在断开时收到错误响应。分块流不重发
+    bool idempotent = false;
+    // 控制消息忽略sendPolicy和发送队列上限，不会因发送缓冲区已满失败；分块流始终按Normal发送
+    MessagePriority priority = MessagePriority::Normal;
+    // 预先分配的请求ID（TcpClient::reserveRequestId），0表示发送时分配；批量请求从该ID起连续编号
+    RequestId requestId = 0;
+
+    // 不设截止时间，用于Agent执行这类耗时不确定的请求
+    static RequestOptions untimed()
+    {
+        RequestOptions options;
+        options.timeoutMs = 0;
+        return options;
+    }
+};
+
+// 批量请求中的一条
+struct BatchRequest
+{
+    QJsonObject request;
+    ResponseCallback callback;
+};
+
+// 连接后与对端协商的结果，握手完成后发出protocolNegotiated
+struct NegotiatedProtocol
+{
+    int version = 0; // 双方协议版本的较小值；0表示对端没有回复握手（旧版），各项单独协商
+    qint64 peerMaxPayloadSize = Protocol::DefaultMaxPayloadSize; // 对端能接收的单帧负载上限
+    Protocol::ChecksumMode checksum = Protocol::ChecksumMode::Sha256;
+    Protocol::CompressionCodec compression = Protocol::CompressionCodec::None;
+    bool syncMarker = false; // 双方写出的帧是否带同步标记（版本2）
+    QSet<char> payloadTypes; // 对端能接收的负载类型
+
+    bool supportsPayloadType(char type) const { return payloadTypes.contains(type); }
+};
 
 class TcpClient : public QObject
 {
     Q_OBJECT
 public:
+    // 日志级别，低于当前级别的日志不做任何格式化
+    enum class LogLevel {
+        Off = 0,  // 关闭
+        Error,    // 错误
+        Info,     // 连接状态、请求和响应事件
+        Frame,    // 每帧的长度、校验和JSON内容
+        Hexdump   // 帧的十六进制内容（按setHexdumpLimit截断）
+    };
+    Q_ENUM(LogLevel)
+
+    // 连接状态
+    enum class ConnectionState {
+        Disconnected,  // 未连接
+        Connecting,    // 正在连接
+        Connected,     // 已连接
+        Reconnecting   // 连接断开或失败，等待退避后重连
+    };
+    Q_ENUM(ConnectionState)
+
     explicit TcpClient(QObject *parent = nullptr);
     ~TcpClient();
 
-    // 连接到服务器
-    bool connectToServer(const QString &host, quint16 port);
-    // 断开连接
+    // 异步连接到服务器，结果通过connected/error信号通知；等待重连时立即重试
+    void connectToServer(const QString &host, quint16 port);
+    // 通过指定的传输层连接：TCP、本地套接字或继承的socketpair
+    // endpoint带共享内存描述符时映射共享内存，连接后告知对端可以发送描述符帧
+    void connectToServer(const TransportEndpoint &endpoint);
+    // 断开连接并停止自动重连，不等待剩余数据写出
     void disconnectFromServer();
     // 检查连接状态
     bool isConnected() const;
+    ConnectionState connectionState() const;
 
-    // 发送消息到服务器
-    QString sendMessage(const QString &message, ResponseCallback callback);
+    // 自动重连，默认关闭：连接意外断开或连接失败后按指数退避重连，
+    // 每次的等待时间在[d/2, d]内随机，d从initialDelayMs起每次翻倍，不超过maxDelayMs
+    void setAutoReconnect(bool enabled, int initialDelayMs = 500, int maxDelayMs = 30000);
+
+    // 心跳，默认关闭：握手完成后每intervalMs发送一次ping，对端立即回复pong并带上事件循环延迟
+    // 连续missedLimit个ping没有收到pong时发出peerUnresponsive，连接不断开，由调用方决定如何处理
+    // intervalMs<=0表示关闭；旧版对端不回复握手，不发送心跳
+    void setHeartbeat(int intervalMs, int missedLimit = 3);
+    // 没有开启心跳或对端按时回复pong时为true
+    bool isPeerResponsive() const;
+
+    // 发送消息到服务器，返回请求ID，未连接时返回0
+    RequestId sendMessage(const QString &message, ResponseCallback callback,
+                          const RequestOptions &options = RequestOptions());
     // 发送计算请求到服务器
-    QString sendCalculateRequest(int a, int b, ResponseCallback callback);
-    // 发送执行命令请求
-    QString sendExecuteCommand(const QString &type, const QString &command, ResponseCallback callback);
-    // 直接发送字符串消息
-    QString sendDirectMessage(const QString &message, ResponseCallback callback);
+    RequestId sendCalculateRequest(int a, int b, ResponseCallback callback,
+                                   const RequestOptions &options = RequestOptions());
+    // 发送执行命令请求；Agent执行时间不确定，默认不设截止时间
+    RequestId sendExecuteCommand(const QString &type, const QString &command, ResponseCallback callback,
+                                 const RequestOptions &options = RequestOptions::untimed());
+    // 直接发送字符串消息，默认不设截止时间
+    RequestId sendDirectMessage(const QString &message, ResponseCallback callback,
+                                const RequestOptions &options = RequestOptions::untimed());
+
+    // 与sendRequest相同，结果通过JsonReply获取（onFinished、QFuture或co_await），截止时间为options.timeoutMs；
+    // 未连接或发送缓冲区已满时立即完成为错误响应；JsonReply::cancel()等同于cancel(requestId)
+    JsonReply request(const QJsonObject &message, const RequestOptions &options = RequestOptions());
+
+    // 取消等待中的请求：回调立即收到code为cancelled的错误响应，释放等待表中的位置；
+    // 对端已收到请求时发送cancel_request，对端停止对应的处理（execute_command对应的Agent随之停止），
+    // 之后到达的响应不再回调。请求已完成或不存在时返回false
+    bool cancel(RequestId requestId);
+    // 预先分配count个连续的请求ID，返回第一个，可以在任意线程调用；通过RequestOptions::requestId传给发送函数，
+    // 其他线程可以在请求发出前就拿到ID，用于之后取消
+    RequestId reserveRequestId(int count = 1);
+
+    // 订阅服务器主动推送的事件（没有requestId，或requestId不对应等待中的请求），如agent_message、thought-end
+    // context为空时在本对象所在线程调用；否则在context所在线程调用，context销毁后不再调用
+    SubscriptionId on(const QString &event, EventHandler handler, QObject *context = nullptr);
+    // 订阅所有推送事件，在按事件名订阅的处理函数之后调用，用于调试和日志工具
+    SubscriptionId onAny(EventHandler handler, QObject *context = nullptr);
+    void off(SubscriptionId id);
+    // 按messages.h中的类型订阅，收到后解码data再调用handler
+    //   client->on<AgentMessage>([](const AgentMessage &message) { message.data.conclusion; });
+    template <typename T>
+    SubscriptionId on(std::function<void(const T &message)> handler, QObject *context = nullptr)
+    {
+        return on(QString::fromLatin1(T::event), [handler](const QJsonObject &message) {
+            handler(Schema::decode<T>(message));
+        }, context);
+    }
     // 发送通用请求到服务器
-    QString sendRequest(const QJsonObject &request, ResponseCallback callback);
+    RequestId sendRequest(const QJsonObject &request, ResponseCallback callback,
+                        const RequestOptions &options = RequestOptions());
+    // 发送messages.h中定义的请求，直接编码为JSON字节，不构造QJsonObject
+    // SCHEMA_CONTROL_MESSAGE定义的消息总是按MessagePriority::Control发送
+    template <typename T>
+    RequestId sendRequest(const T &message, ResponseCallback callback,
+                          const RequestOptions &options = RequestOptions())
+    {
+        if (!isConnected()) {
+            emit error("未连接到服务器");
+            return 0;
+        }
+        RequestOptions sendOptions = options;
+        if (T::control) {
+            sendOptions.priority = MessagePriority::Control;
+        }
+        RequestId requestId = takeRequestId(sendOptions);
+        if (!sendEncodedRequest(requestId, T::event, Schema::encodeRequest(message, requestId),
+                                std::move(callback), sendOptions)) {
+            return 0;
+        }
+        return requestId;
+    }
+    // 发送二进制负载（截图、文件内容等），不做base64编码
+    // 对端支持分块时，超过一个分块的负载按sendStream分块发送，控制消息可以插在分块之间（可重发的请求除外）
+    RequestId sendBinary(const QString &event, const QByteArray &data, ResponseCallback callback,
+                       char payloadType = Protocol::PayloadBinary, const QJsonObject &meta = QJsonObject(),
+                       const RequestOptions &options = RequestOptions());
+
+    // 把多个请求打包成一个批量帧发送，对端同样以批量帧回复；对端不支持批量帧时逐条发送
+    // 返回各请求的ID，未连接时返回空列表
+    QVector<RequestId> sendBatch(const QVector<BatchRequest> &requests,
+                                 const RequestOptions &options = RequestOptions());
+
+    // 合并写入：同一轮事件循环内产生的帧在下一轮合并为一次socket写入，默认关闭
+    void setWriteCoalescing(bool enabled);
+
+    // 发送缓冲区水位，默认4MB/1MB：未写出的数据（写缓冲区、发送队列和分块流中尚未发出的部分）达到high时发出writeBlocked，
+    // 之后的消息按SendPolicy处理；降到low后发出writeReady
+    void setWriteWatermarks(qint64 high, qint64 low);
+    // 发送队列上限，默认16MB，分块流中尚未发出的部分一并计入
+    void setSendQueueLimit(qint64 bytes);
+    // 写缓冲区中普通消息的上限，默认256KB：超过时新的普通消息在发送队列中等待写缓冲区空闲，
+    // 控制消息最多排在这么多数据后面
+    void setWriteBudget(qint64 bytes);
+    bool isWriteBlocked() const;
+    qint64 queuedBytes() const;
+
+    // 分块发送大负载，socket写缓冲区中最多积压一个分块，期间发送的其他消息插在分块之间
+    // 对端不支持分块时按单个二进制帧发送
+    RequestId sendStream(const QString &event, const QByteArray &data, ResponseCallback callback,
+                       char payloadType = Protocol::PayloadBinary, const QJsonObject &meta = QJsonObject(),
+                       const RequestOptions &options = RequestOptions());
+    // 分块大小，默认64KB
+    void setChunkSize(int bytes);
+
+    // 注册某个事件的流处理函数，分块到达即回调，不拼接整个负载；handler为空表示取消注册
+    // 未注册的流拼接完整后交给元数据中负载类型对应的处理函数
+    void registerStreamHandler(const QString &event, StreamHandler handler);
+
+    // 注册二进制负载类型的处理函数，连接时告知对端；handler为空表示取消注册
+    // 默认已注册PayloadBinary和PayloadImage，收到后发出binaryMessage信号
+    void registerPayloadType(char payloadType, PayloadHandler handler);
+
+    // 期望使用的校验模式，连接后与对端协商；对端不支持时保持SHA-256
+    void setPreferredChecksumMode(Protocol::ChecksumMode mode);
+    // 当前发送使用的校验模式
+    Protocol::ChecksumMode checksumMode() const;
+
+    // 期望使用的压缩算法和阈值（超过threshold字节的负载才压缩），连接后与对端协商
+    // 本端不支持的算法回退到Deflate，None表示不压缩
+    void setCompression(Protocol::CompressionCodec codec, int threshold = 4096);
+    // 当前发送使用的压缩算法
+    Protocol::CompressionCodec compressionCodec() const;
+
+    // 本端能接收的单帧负载上限，默认256MB，连接前设置，在握手中告知对端
+    // 长度字段超过上限的帧不再等待其数据：带同步标记时跳到下一个标记，旧版帧断开连接
+    void setMaxFrameSize(int bytes);
+    int maxFrameSize() const;
+
+    // 当前连接的协商结果：连接后发送握手消息，一次交换协议版本、负载上限、校验模式、压缩算法和负载类型；
+    // 对端未回复握手时按旧版协议逐项协商，结果随各项回复更新
+    NegotiatedProtocol negotiated() const;
+
+    // 统计快照：帧、字节、校验和解析失败等计数，以及各事件请求耗时的直方图摘要
+    // 计数器是原子变量，可以在任意线程调用，开销很小，生产环境可以一直开启
+    ClientStats stats() const;
+    // 返回本窗口的统计并把计数和直方图清零，开始新的窗口；RTT等最近测量值保留
+    ClientStats resetStats();
+
+    // 日志级别，默认Info
+    void setLogLevel(LogLevel level);
+    LogLevel logLevel() const;
+    // 十六进制输出的最大字节数，默认256
+    void setHexdumpLimit(int bytes);
 
 signals:
     void connected();
     void disconnected();
     void error(const QString &errorMsg);
     void logMessage(const QString &message);
+    void binaryMessage(char payloadType, const QJsonObject &meta, const QByteArray &data);
+    void writeBlocked();
+    void writeReady();
+    void stateChanged(TcpClient::ConnectionState state);
+    // 对端回复握手，或握手超时后改为逐项协商
+    void protocolNegotiated(const NegotiatedProtocol &protocol);
+    // 连续missedPongs个ping没有回复，对端事件循环可能卡住；之后收到pong时发出peerRecovered
+    void peerUnresponsive(int missedPongs);
+    void peerRecovered();
 
 private slots:
     void onConnected();
     void onDisconnected();
     void onReadyRead();
-    void onError(QAbstractSocket::SocketError socketError);
+    void onError();
     void onTimeout();
+    void pumpStreams();
+    void flushWrites();
+    void onBytesWritten();
+    void onConnectTimeout();
+    void onHelloTimeout();
+    void onHeartbeat();
+    void startConnect();
 
 private:
-    QTcpSocket m_socket;
-    QMap<QString, ResponseCallback> m_pendingRequests;
+    // 传输层和定时器以本对象为父对象，moveToThread时随之移动
+    Transport *m_transport;
+    PendingRequestTable m_pendingRequests;
+    // 原子变量，reserveRequestId可以在其他线程调用
+    std::atomic<RequestId> m_nextRequestId;
+    // 请求超时：时间轮按tick推进，只在有等待中的请求时运行定时器
+    TimerWheel m_deadlines;
     QTimer m_timeoutTimer;
-    static const int TIMEOUT_MS = 5000; // 5秒超时
+    // 统计，读取不改变状态，可以在其他线程进行
+    mutable ClientMetrics m_metrics;
+
+    // 连接状态机
+    ConnectionState m_state;
+    QTimer m_connectTimer;
+    QTimer m_reconnectTimer;
+    bool m_autoReconnect;
+    bool m_reconnectWanted; // connectToServer之后、disconnectFromServer之前
+    int m_reconnectInitialDelay;
+    int m_reconnectMaxDelay;
+    int m_reconnectAttempt;
+    QElapsedTimer m_reconnectClock; // 意外断开时开始计时，重连成功后记入统计
+
+    // 单调时钟，心跳和请求耗时共用
+    QElapsedTimer m_clock;
+
+    // 心跳：ping带上发送时刻，pong原样带回，不需要记录每个ping
+    QTimer m_heartbeatTimer;
+    int m_heartbeatInterval;
+    int m_heartbeatMissedLimit;
+    quint32 m_nextPingSeq;
+    int m_outstandingPings; // 上次收到pong之后发出的ping数
+    bool m_rttSampled;
+    bool m_peerUnresponsive;
+
+    // 可重发的请求，重连后按ID顺序以当时的编码参数重新编码发送
+    struct ReplayableRequest
+    {
+        char payloadType; // PayloadJson时message是整条请求（类型化请求已编码，放在data中），否则是二进制负载的元数据
+        QJsonObject message;
+        QByteArray data;
+    };
+    QHash<RequestId, ReplayableRequest> m_replayable;
     
     // 黏包处理相关
-    QByteArray m_receiveBuffer;
+    FrameDecoder m_decoder;
+
+    // 合并写入
+    bool m_coalesceWrites;
+    bool m_flushScheduled;
+    QByteArray m_writeBuffer;
+
+    // 发送队列，写缓冲区达到高水位后新帧在这里排队
+    struct QueuedFrame
+    {
+        EncodedFrame frame;
+        SendPolicy policy;
+        RequestId firstRequestId;
+        int requestCount;
+    };
+    QList<QueuedFrame> m_sendQueue;
+    qint64 m_highWatermark;
+    qint64 m_lowWatermark;
+    qint64 m_maxQueuedBytes;
+    qint64 m_queuedBytes;
+    qint64 m_writeBudget;
+    bool m_writeBlocked;
+
+    // 发送编码参数（校验模式、压缩算法）由协商决定，接收按帧标志位逐帧判断
+    Protocol::ChecksumMode m_preferredChecksumMode;
+    Protocol::CompressionCodec m_preferredCompression;
+    FrameEncoding m_encoding;
+
+    // 二进制负载类型 -> 处理函数
+    QHash<char, PayloadHandler> m_payloadHandlers;
+    // 对端能接收的负载类型，来自握手回复或对端的payload_types
+    QSet<char> m_peerPayloadTypes;
+    // 握手结果，版本为0时对端尚未回复
+    int m_peerVersion;
+    qint64 m_peerMaxPayloadSize;
+    QTimer m_helloTimer;
+    // 与子进程共享的环形缓冲区，没有时为nullptr
+    SharedRing *m_sharedRing;
+
+    // 分块流
+    struct OutgoingStream
+    {
+        quint32 id;
+        RequestId requestId;
+        SendPolicy policy;
+        QByteArray meta;
+        QByteArray data;
+        int offset;
+        quint32 sequence;
+    };
+    struct IncomingStream
+    {
+        char payloadType;
+        QJsonObject meta;
+        quint32 nextSequence;
+        qint64 received;
+        QByteArray buffer; // 没有流处理函数时拼接完整负载
+    };
+    QList<OutgoingStream> m_outgoingStreams;
+    QHash<quint32, IncomingStream> m_incomingStreams;
+    QHash<QString, StreamHandler> m_streamHandlers;
+    quint32 m_nextStreamId;
+    int m_chunkSize;
+    qint64 m_streamBytes; // 分块流中尚未提交到写缓冲区的字节数
+
+    // 推送事件订阅：事件名在订阅时登记为连续的ID，收到消息时用消息中event的原始字节查一次哈希表，再按下标取处理函数
+    struct Subscription
+    {
+        SubscriptionId id;
+        EventHandler handler;
+        bool hasContext;
+        QPointer<QObject> context;
+    };
+    QHash<QByteArray, int> m_eventIds;
+    QVector<QVector<Subscription>> m_eventSubscriptions;
+    QVector<Subscription> m_anySubscriptions;
+    SubscriptionId m_nextSubscriptionId;
+
+    // 日志相关
+    LogLevel m_logLevel;
+    int m_hexdumpLimit;
+    bool shouldLog(LogLevel level) const { return level <= m_logLevel; }
     
     // 协议相关方法
-    QByteArray buildProtocolMessage(const QJsonObject &message);
-    QByteArray buildProtocolMessageDirect(const QByteArray &rawData);
-    quint32 calculateCRC32(const QByteArray &data);
-    void processReceivedData(const QByteArray &data);
+    EncodedFrame buildProtocolMessage(const QJsonObject &message);
+    EncodedFrame buildProtocolMessageDirect(const QByteArray &rawData);
+    RequestId takeRequestId(const RequestOptions &options);
+    bool sendEncodedRequest(RequestId requestId, const char *event, const QByteArray &jsonData,
+                            ResponseCallback callback, const RequestOptions &options);
+    EncodedFrame encodeFrame(const QByteArray &payload, const char *lengthNote);
+    bool writeFrame(const EncodedFrame &frame, SendPolicy policy = SendPolicy::Wait,
+                    RequestId firstRequestId = 0, int requestCount = 1);
+    bool writeFrame(const EncodedFrame &frame, const RequestOptions &options,
+                    RequestId firstRequestId, int requestCount = 1);
+    void writeControlFrame(const EncodedFrame &frame);
+    void submitFrame(const EncodedFrame &frame);
+    void drainSendQueue();
+    bool admitToQueue(qint64 bytes, SendPolicy policy, int requestCount);
+    void checkHighWatermark();
+    qint64 pendingWriteBytes() const;
+    qint64 backlogBytes() const;
+    EncodedFrame buildBinaryMessage(char payloadType, const QJsonObject &meta, const QByteArray &data);
+    void logEncodedFrame(const EncodedFrame &frame, const char *lengthNote);
+    void processReceivedData();
+    void dispatchJsonMessage(const QByteArray &jsonData);
+    void dispatchBatchFrame(const FrameView &frame);
+    void dispatchBinaryFrame(const FrameView &frame);
+    void dispatchChunkFrame(const FrameView &frame);
+    void dispatchSharedFrame(const FrameView &frame);
+    void recordPayloadLatency(const QJsonObject &meta);
+    void addPendingRequest(RequestId requestId, ResponseCallback callback, int timeoutMs, const QString &event);
+    void reportParseFailure(const QString &message);
+    bool resolvePendingRequest(const QJsonObject &response);
+    ResponseCallback takePendingCallback(RequestId requestId);
+    void dispatchEvent(const MessageView &message);
+    void invokeSubscription(const Subscription &subscription, const QJsonObject &message);
+    void failPendingRequest(RequestId requestId, const QString &code, const QString &message);
+    void failAllPendingRequests(bool keepReplayable);
+    void rememberForReplay(RequestId requestId, char payloadType, const QJsonObject &message,
+                           const QByteArray &data = QByteArray());
+    void replayPendingRequests();
+    bool reconnectEnabled() const { return m_autoReconnect && m_reconnectWanted; }
+    void handleConnectFailure(const QString &reason);
+    void scheduleReconnect();
+    void setState(ConnectionState state);
+    void resetTransport();
+    void disconnectTransport();
+    void sendHello();
+    void startHeartbeat();
+    void handlePong(const QJsonObject &data);
+    QJsonArray localPayloadTypes() const;
+    QJsonArray checksumModeOffer() const;
+    QJsonArray compressionCodecOffer() const;
+    void applyPeerChecksumMode(const QString &modeName);
+    void applyPeerCompression(const QString &codecName);
+    void applyPeerPayloadTypes(const QJsonArray &types);
+    void sendPayloadTypes();
+    void sendChecksumNegotiation();
+    void sendCompressionNegotiation();
+    bool handleProtocolMessage(const MessageView &message);
 };
 
 #endif // TCPCLIENT_H 
\ No newline at end of file
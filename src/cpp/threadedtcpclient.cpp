@@ -0,0 +1,375 @@
+#include "threadedtcpclient.h"
+
+ThreadedTcpClient::ThreadedTcpClient(QObject *parent)
+    : QObject(parent)
+    , m_client(new TcpClient)
+    , m_wakeupPending(false)
+    , m_connected(false)
+{
+    m_thread.setObjectName("TcpClientThread");
+    m_client->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_client, &QObject::deleteLater);
+
+    // 信号在网络线程直接调用，放入投递队列后在界面线程发出
+    connect(m_client, &TcpClient::connected, this, [this]() {
+        post([this]() {
+            m_connected = true;
+            emit connected();
+        });
+    }, Qt::DirectConnection);
+    connect(m_client, &TcpClient::disconnected, this, [this]() {
+        post([this]() {
+            m_connected = false;
+            emit disconnected();
+        });
+    }, Qt::DirectConnection);
+    connect(m_client, &TcpClient::error, this, [this](const QString &errorMsg) {
+        post([this, errorMsg]() { emit error(errorMsg); });
+    }, Qt::DirectConnection);
+    connect(m_client, &TcpClient::logMessage, this, [this](const QString &message) {
+        post([this, message]() { emit logMessage(message); });
+    }, Qt::DirectConnection);
+    connect(m_client, &TcpClient::binaryMessage, this,
+            [this](char payloadType, const QJsonObject &meta, const QByteArray &data) {
+        post([this, payloadType, meta, data]() { emit binaryMessage(payloadType, meta, data); });
+    }, Qt::DirectConnection);
+    connect(m_client, &TcpClient::writeBlocked, this, [this]() {
+        post([this]() { emit writeBlocked(); });
+    }, Qt::DirectConnection);
+    connect(m_client, &TcpClient::writeReady, this, [this]() {
+        post([this]() { emit writeReady(); });
+    }, Qt::DirectConnection);
+    connect(m_client, &TcpClient::stateChanged, this, [this](TcpClient::ConnectionState state) {
+        post([this, state]() { emit stateChanged(state); });
+    }, Qt::DirectConnection);
+    connect(m_client, &TcpClient::protocolNegotiated, this, [this](const NegotiatedProtocol &protocol) {
+        post([this, protocol]() { emit protocolNegotiated(protocol); });
+    }, Qt::DirectConnection);
+    connect(m_client, &TcpClient::peerUnresponsive, this, [this](int missedPongs) {
+        post([this, missedPongs]() { emit peerUnresponsive(missedPongs); });
+    }, Qt::DirectConnection);
+    connect(m_client, &TcpClient::peerRecovered, this, [this]() {
+        post([this]() { emit peerRecovered(); });
+    }, Qt::DirectConnection);
+
+    m_thread.start();
+}
+
+ThreadedTcpClient::~ThreadedTcpClient()
+{
+    // 在网络线程解除信号并断开连接，等待表随之清空，之后不会再有新的投递
+    QMetaObject::invokeMethod(m_client, [this]() {
+        QObject::disconnect(m_client, nullptr, this, nullptr);
+        m_client->disconnectFromServer();
+    }, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void ThreadedTcpClient::connectToServer(const QString &host, quint16 port)
+{
+    runInNetworkThread([this, host, port]() { m_client->connectToServer(host, port); });
+}
+
+void ThreadedTcpClient::connectToServer(const TransportEndpoint &endpoint)
+{
+    runInNetworkThread([this, endpoint]() { m_client->connectToServer(endpoint); });
+}
+
+void ThreadedTcpClient::disconnectFromServer()
+{
+    runInNetworkThread([this]() { m_client->disconnectFromServer(); });
+}
+
+bool ThreadedTcpClient::isConnected() const
+{
+    return m_connected;
+}
+
+RequestId ThreadedTcpClient::sendMessage(const QString &message, ResponseCallback callback,
+                                         const RequestOptions &options)
+{
+    RequestOptions sendOptions = withRequestId(options);
+    ResponseCallback deliver = deliverToUi(std::move(callback));
+    runInNetworkThread([this, message, deliver, sendOptions]() {
+        m_client->sendMessage(message, deliver, sendOptions);
+    });
+    return sendOptions.requestId;
+}
+
+RequestId ThreadedTcpClient::sendCalculateRequest(int a, int b, ResponseCallback callback,
+                                                  const RequestOptions &options)
+{
+    RequestOptions sendOptions = withRequestId(options);
+    ResponseCallback deliver = deliverToUi(std::move(callback));
+    runInNetworkThread([this, a, b, deliver, sendOptions]() {
+        m_client->sendCalculateRequest(a, b, deliver, sendOptions);
+    });
+    return sendOptions.requestId;
+}
+
+RequestId ThreadedTcpClient::sendExecuteCommand(const QString &type, const QString &command,
+                                                ResponseCallback callback, const RequestOptions &options)
+{
+    RequestOptions sendOptions = withRequestId(options);
+    ResponseCallback deliver = deliverToUi(std::move(callback));
+    runInNetworkThread([this, type, command, deliver, sendOptions]() {
+        m_client->sendExecuteCommand(type, command, deliver, sendOptions);
+    });
+    return sendOptions.requestId;
+}
+
+RequestId ThreadedTcpClient::sendDirectMessage(const QString &message, ResponseCallback callback,
+                                               const RequestOptions &options)
+{
+    RequestOptions sendOptions = withRequestId(options);
+    ResponseCallback deliver = deliverToUi(std::move(callback));
+    runInNetworkThread([this, message, deliver, sendOptions]() {
+        m_client->sendDirectMessage(message, deliver, sendOptions);
+    });
+    return sendOptions.requestId;
+}
+
+RequestId ThreadedTcpClient::sendRequest(const QJsonObject &request, ResponseCallback callback,
+                                         const RequestOptions &options)
+{
+    RequestOptions sendOptions = withRequestId(options);
+    ResponseCallback deliver = deliverToUi(std::move(callback));
+    runInNetworkThread([this, request, deliver, sendOptions]() {
+        m_client->sendRequest(request, deliver, sendOptions);
+    });
+    return sendOptions.requestId;
+}
+
+RequestId ThreadedTcpClient::sendBinary(const QString &event, const QByteArray &data, ResponseCallback callback,
+                                        char payloadType, const QJsonObject &meta, const RequestOptions &options)
+{
+    RequestOptions sendOptions = withRequestId(options);
+    ResponseCallback deliver = deliverToUi(std::move(callback));
+    runInNetworkThread([this, event, data, deliver, payloadType, meta, sendOptions]() {
+        m_client->sendBinary(event, data, deliver, payloadType, meta, sendOptions);
+    });
+    return sendOptions.requestId;
+}
+
+RequestId ThreadedTcpClient::sendStream(const QString &event, const QByteArray &data, ResponseCallback callback,
+                                        char payloadType, const QJsonObject &meta, const RequestOptions &options)
+{
+    RequestOptions sendOptions = withRequestId(options);
+    ResponseCallback deliver = deliverToUi(std::move(callback));
+    runInNetworkThread([this, event, data, deliver, payloadType, meta, sendOptions]() {
+        m_client->sendStream(event, data, deliver, payloadType, meta, sendOptions);
+    });
+    return sendOptions.requestId;
+}
+
+// 批量请求的ID连续，一次预先分配
+QVector<RequestId> ThreadedTcpClient::sendBatch(const QVector<BatchRequest> &requests, const RequestOptions &options)
+{
+    QVector<RequestId> requestIds;
+    if (requests.isEmpty()) {
+        return requestIds;
+    }
+    RequestOptions sendOptions = options;
+    if (sendOptions.requestId == 0) {
+        sendOptions.requestId = m_client->reserveRequestId(requests.size());
+    }
+    QVector<BatchRequest> deliverRequests = requests;
+    requestIds.reserve(requests.size());
+    for (BatchRequest &item : deliverRequests) {
+        item.callback = deliverToUi(std::move(item.callback));
+        requestIds.append(sendOptions.requestId + requestIds.size());
+    }
+    runInNetworkThread([this, deliverRequests, sendOptions]() { m_client->sendBatch(deliverRequests, sendOptions); });
+    return requestIds;
+}
+
+JsonReply ThreadedTcpClient::request(const QJsonObject &message, const RequestOptions &options)
+{
+    JsonReply reply;
+    RequestOptions sendOptions = withRequestId(options);
+    runInNetworkThread([this, message, sendOptions, reply]() {
+        // 发出前已在界面线程取消，不再发送
+        if (reply.isFinished()) {
+            return;
+        }
+        JsonReply networkReply = m_client->request(message, sendOptions);
+        JsonReply::Weak weakNetworkReply(networkReply);
+        networkReply.onFinished([this, weakNetworkReply, reply]() {
+            QJsonObject result = weakNetworkReply.result();
+            post([result, reply]() { reply.finish(result); });
+        });
+    });
+    // cancel()可能在界面线程或其他线程调用，等待表只在网络线程访问，转交网络线程取消；
+    // 取消排在发送之后执行，请求已发出时由TcpClient通知对端
+    QPointer<ThreadedTcpClient> self(this);
+    RequestId requestId = sendOptions.requestId;
+    JsonReply::Weak weakReply(reply);
+    reply.onFinished([self, weakReply, requestId]() {
+        if (weakReply.isCanceled() && self) {
+            self->cancel(requestId);
+        }
+    });
+    return reply;
+}
+
+void ThreadedTcpClient::cancel(RequestId requestId)
+{
+    runInNetworkThread([this, requestId]() { m_client->cancel(requestId); });
+}
+
+SubscriptionId ThreadedTcpClient::on(const QString &event, EventHandler handler, QObject *context)
+{
+    EventHandler deliver = deliverEventToUi(std::move(handler), context);
+    SubscriptionId id = 0;
+    QMetaObject::invokeMethod(m_client, [this, &id, &event, &deliver, context]() {
+        id = m_client->on(event, deliver, context);
+    }, Qt::BlockingQueuedConnection);
+    return id;
+}
+
+SubscriptionId ThreadedTcpClient::onAny(EventHandler handler, QObject *context)
+{
+    EventHandler deliver = deliverEventToUi(std::move(handler), context);
+    SubscriptionId id = 0;
+    QMetaObject::invokeMethod(m_client, [this, &id, &deliver, context]() {
+        id = m_client->onAny(deliver, context);
+    }, Qt::BlockingQueuedConnection);
+    return id;
+}
+
+void ThreadedTcpClient::off(SubscriptionId id)
+{
+    runInNetworkThread([this, id]() { m_client->off(id); });
+}
+
+void ThreadedTcpClient::setAutoReconnect(bool enabled, int initialDelayMs, int maxDelayMs)
+{
+    runInNetworkThread([this, enabled, initialDelayMs, maxDelayMs]() {
+        m_client->setAutoReconnect(enabled, initialDelayMs, maxDelayMs);
+    });
+}
+
+void ThreadedTcpClient::setHeartbeat(int intervalMs, int missedLimit)
+{
+    runInNetworkThread([this, intervalMs, missedLimit]() { m_client->setHeartbeat(intervalMs, missedLimit); });
+}
+
+void ThreadedTcpClient::setWriteCoalescing(bool enabled)
+{
+    runInNetworkThread([this, enabled]() { m_client->setWriteCoalescing(enabled); });
+}
+
+void ThreadedTcpClient::setWriteWatermarks(qint64 high, qint64 low)
+{
+    runInNetworkThread([this, high, low]() { m_client->setWriteWatermarks(high, low); });
+}
+
+void ThreadedTcpClient::setSendQueueLimit(qint64 bytes)
+{
+    runInNetworkThread([this, bytes]() { m_client->setSendQueueLimit(bytes); });
+}
+
+void ThreadedTcpClient::setWriteBudget(qint64 bytes)
+{
+    runInNetworkThread([this, bytes]() { m_client->setWriteBudget(bytes); });
+}
+
+void ThreadedTcpClient::setChunkSize(int bytes)
+{
+    runInNetworkThread([this, bytes]() { m_client->setChunkSize(bytes); });
+}
+
+void ThreadedTcpClient::setPreferredChecksumMode(Protocol::ChecksumMode mode)
+{
+    runInNetworkThread([this, mode]() { m_client->setPreferredChecksumMode(mode); });
+}
+
+void ThreadedTcpClient::setCompression(Protocol::CompressionCodec codec, int threshold)
+{
+    runInNetworkThread([this, codec, threshold]() { m_client->setCompression(codec, threshold); });
+}
+
+void ThreadedTcpClient::setMaxFrameSize(int bytes)
+{
+    runInNetworkThread([this, bytes]() { m_client->setMaxFrameSize(bytes); });
+}
+
+void ThreadedTcpClient::setLogLevel(TcpClient::LogLevel level)
+{
+    runInNetworkThread([this, level]() { m_client->setLogLevel(level); });
+}
+
+void ThreadedTcpClient::setHexdumpLimit(int bytes)
+{
+    runInNetworkThread([this, bytes]() { m_client->setHexdumpLimit(bytes); });
+}
+
+NegotiatedProtocol ThreadedTcpClient::negotiated() const
+{
+    NegotiatedProtocol result;
+    QMetaObject::invokeMethod(m_client, [this, &result]() { result = m_client->negotiated(); },
+                              Qt::BlockingQueuedConnection);
+    return result;
+}
+
+ClientStats ThreadedTcpClient::stats() const
+{
+    return m_client->stats();
+}
+
+ClientStats ThreadedTcpClient::resetStats()
+{
+    return m_client->resetStats();
+}
+
+// 在调用线程预先分配请求ID，发送前就可以返回给调用方
+RequestOptions ThreadedTcpClient::withRequestId(const RequestOptions &options) const
+{
+    RequestOptions sendOptions = options;
+    if (sendOptions.requestId == 0) {
+        sendOptions.requestId = m_client->reserveRequestId();
+    }
+    return sendOptions;
+}
+
+// 回调在网络线程被调用时只把响应放入投递队列
+ResponseCallback ThreadedTcpClient::deliverToUi(ResponseCallback callback)
+{
+    if (!callback) {
+        return callback;
+    }
+    return [this, callback](const QJsonObject &response) {
+        post([callback, response]() { callback(response); });
+    };
+}
+
+// 没有指定context的事件处理函数和响应回调一样经投递队列在界面线程调用，指定了context时由TcpClient排队到它的线程
+EventHandler ThreadedTcpClient::deliverEventToUi(EventHandler handler, QObject *context)
+{
+    if (context) {
+        return handler;
+    }
+    return [this, handler](const QJsonObject &message) {
+        post([handler, message]() { handler(message); });
+    };
+}
+
+// 网络线程调用：入队，界面线程尚未被唤醒时唤醒一次
+void ThreadedTcpClient::post(Delivery delivery)
+{
+    m_deliveries.push(std::move(delivery));
+    if (!m_wakeupPending.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, &ThreadedTcpClient::drainDeliveries, Qt::QueuedConnection);
+    }
+}
+
+// 界面线程：先清除唤醒标记再取队列，之后入队的投递会触发新的唤醒
+void ThreadedTcpClient::drainDeliveries()
+{
+    m_wakeupPending.exchange(false, std::memory_order_acq_rel);
+    Delivery delivery;
+    while (m_deliveries.tryPop(&delivery)) {
+        delivery();
+    }
+}
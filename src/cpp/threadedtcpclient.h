@@ -0,0 +1,134 @@
+#ifndef THREADEDTCPCLIENT_H
+#define THREADEDTCPCLIENT_H
+
+#include <QObject>
+#include <QThread>
+#include <atomic>
+#include "tcpclient.h"
+#include "smallfunction.h"
+#include "spscqueue.h"
+
+// 在独立网络线程中运行TcpClient：socket、解码、校验、JSON解析和等待表都在网络线程，
+// 回调和信号在创建本对象的线程（界面线程）执行
+// 网络线程把完成的响应放入无锁队列，界面线程每批只被唤醒一次，而不是每条消息一个排队信号
+// 发送和配置调用异步转交网络线程，结果通过回调和信号返回
+class ThreadedTcpClient : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ThreadedTcpClient(QObject *parent = nullptr);
+    ~ThreadedTcpClient();
+
+    // 与TcpClient相同，异步连接，成功发出connected，失败发出error
+    void connectToServer(const QString &host, quint16 port);
+    void connectToServer(const TransportEndpoint &endpoint);
+    void disconnectFromServer();
+    // 界面线程看到的连接状态，与connected/disconnected信号的顺序一致
+    bool isConnected() const;
+
+    // 与TcpClient的同名函数相同，回调在界面线程执行
+    // 请求ID在调用线程预先分配后返回，可以立即用于cancel；未连接等原因发送失败时回调不会被调用，与TcpClient返回0相同
+    RequestId sendMessage(const QString &message, ResponseCallback callback,
+                          const RequestOptions &options = RequestOptions());
+    RequestId sendCalculateRequest(int a, int b, ResponseCallback callback,
+                                   const RequestOptions &options = RequestOptions());
+    RequestId sendExecuteCommand(const QString &type, const QString &command, ResponseCallback callback,
+                                 const RequestOptions &options = RequestOptions::untimed());
+    RequestId sendDirectMessage(const QString &message, ResponseCallback callback,
+                                const RequestOptions &options = RequestOptions::untimed());
+    RequestId sendRequest(const QJsonObject &request, ResponseCallback callback,
+                          const RequestOptions &options = RequestOptions());
+    template <typename T>
+    RequestId sendRequest(const T &message, ResponseCallback callback, const RequestOptions &options = RequestOptions())
+    {
+        RequestOptions sendOptions = withRequestId(options);
+        ResponseCallback deliver = deliverToUi(std::move(callback));
+        runInNetworkThread([this, message, deliver, sendOptions]() {
+            m_client->sendRequest(message, deliver, sendOptions);
+        });
+        return sendOptions.requestId;
+    }
+    RequestId sendBinary(const QString &event, const QByteArray &data, ResponseCallback callback,
+                         char payloadType = Protocol::PayloadBinary, const QJsonObject &meta = QJsonObject(),
+                         const RequestOptions &options = RequestOptions());
+    RequestId sendStream(const QString &event, const QByteArray &data, ResponseCallback callback,
+                         char payloadType = Protocol::PayloadBinary, const QJsonObject &meta = QJsonObject(),
+                         const RequestOptions &options = RequestOptions());
+    QVector<RequestId> sendBatch(const QVector<BatchRequest> &requests, const RequestOptions &options = RequestOptions());
+    // 与TcpClient::request相同，结果在界面线程完成，co_await之后的代码也在界面线程继续；cancel()同样取消网络线程中的请求
+    JsonReply request(const QJsonObject &message, const RequestOptions &options = RequestOptions());
+    // 与TcpClient::cancel相同，转交网络线程执行；回调随后在界面线程收到cancelled错误响应，请求已完成时没有影响
+    void cancel(RequestId requestId);
+
+    // 与TcpClient相同，context为空时在界面线程调用；同步等待网络线程登记
+    SubscriptionId on(const QString &event, EventHandler handler, QObject *context = nullptr);
+    template <typename T>
+    SubscriptionId on(std::function<void(const T &message)> handler, QObject *context = nullptr)
+    {
+        return on(QString::fromLatin1(T::event), [handler](const QJsonObject &message) {
+            handler(Schema::decode<T>(message));
+        }, context);
+    }
+    SubscriptionId onAny(EventHandler handler, QObject *context = nullptr);
+    void off(SubscriptionId id);
+
+    // 配置，转交网络线程执行
+    void setAutoReconnect(bool enabled, int initialDelayMs = 500, int maxDelayMs = 30000);
+    void setHeartbeat(int intervalMs, int missedLimit = 3);
+    void setWriteCoalescing(bool enabled);
+    void setWriteWatermarks(qint64 high, qint64 low);
+    void setSendQueueLimit(qint64 bytes);
+    void setWriteBudget(qint64 bytes);
+    void setChunkSize(int bytes);
+    void setPreferredChecksumMode(Protocol::ChecksumMode mode);
+    void setCompression(Protocol::CompressionCodec codec, int threshold = 4096);
+    void setMaxFrameSize(int bytes);
+    void setLogLevel(TcpClient::LogLevel level);
+    void setHexdumpLimit(int bytes);
+
+    // 协商结果，同步等待网络线程返回
+    NegotiatedProtocol negotiated() const;
+    // 统计，直接读取原子计数，不等待网络线程
+    ClientStats stats() const;
+    ClientStats resetStats();
+
+signals:
+    void connected();
+    void disconnected();
+    void error(const QString &errorMsg);
+    void logMessage(const QString &message);
+    void binaryMessage(char payloadType, const QJsonObject &meta, const QByteArray &data);
+    void writeBlocked();
+    void writeReady();
+    void stateChanged(TcpClient::ConnectionState state);
+    void protocolNegotiated(const NegotiatedProtocol &protocol);
+    void peerUnresponsive(int missedPongs);
+    void peerRecovered();
+
+private slots:
+    void drainDeliveries();
+
+private:
+    // 在界面线程执行的一项投递（回调或信号）
+    using Delivery = SmallFunction<void(), 80>;
+
+    void post(Delivery delivery);
+    RequestOptions withRequestId(const RequestOptions &options) const;
+    ResponseCallback deliverToUi(ResponseCallback callback);
+    EventHandler deliverEventToUi(EventHandler handler, QObject *context);
+    template <typename F>
+    void runInNetworkThread(F &&function)
+    {
+        QMetaObject::invokeMethod(m_client, std::forward<F>(function), Qt::QueuedConnection);
+    }
+
+    QThread m_thread;
+    TcpClient *m_client; // 属于网络线程，线程结束时释放
+    // 网络线程生产，界面线程消费
+    SpscQueue<Delivery> m_deliveries;
+    // 已请求唤醒界面线程且尚未开始处理
+    std::atomic<bool> m_wakeupPending;
+    bool m_connected;
+};
+
+#endif // THREADEDTCPCLIENT_H
@@ -0,0 +1,71 @@
+#include "timerwheel.h"
+
+TimerWheel::TimerWheel(int tickMs, int slotCount)
+    : m_mask(0)
+    , m_tickMs(qMax(1, tickMs))
+    , m_currentTick(0)
+    , m_size(0)
+{
+    int slots = 1;
+    while (slots < slotCount) {
+        slots <<= 1;
+    }
+    m_slots.resize(slots);
+    m_mask = slots - 1;
+    m_clock.start();
+}
+
+void TimerWheel::schedule(quint64 key, int delayMs)
+{
+    qint64 now = m_clock.elapsed();
+    if (m_size == 0) {
+        // 空轮期间没有推进，先对齐到当前时间
+        m_currentTick = now / m_tickMs;
+    }
+
+    // 向上取整到tick，保证不会提前触发
+    qint64 tick = (now + qMax(0, delayMs) + m_tickMs - 1) / m_tickMs;
+    if (tick <= m_currentTick) {
+        tick = m_currentTick + 1;
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.rounds = static_cast<int>((tick - m_currentTick - 1) / m_slots.size());
+    m_slots[static_cast<int>(tick & m_mask)].append(entry);
+    ++m_size;
+}
+
+void TimerWheel::advance(QVector<quint64> *expired)
+{
+    qint64 nowTick = m_clock.elapsed() / m_tickMs;
+    while (m_currentTick < nowTick && m_size > 0) {
+        ++m_currentTick;
+        QVector<Entry> &slot = m_slots[static_cast<int>(m_currentTick & m_mask)];
+        for (int i = 0; i < slot.size();) {
+            if (slot[i].rounds > 0) {
+                --slot[i].rounds;
+                ++i;
+                continue;
+            }
+            expired->append(slot[i].key);
+            // 与末尾交换后删除，槽内顺序无关
+            if (i != slot.size() - 1) {
+                slot[i] = slot.last();
+            }
+            slot.removeLast();
+            --m_size;
+        }
+    }
+    if (m_size == 0) {
+        m_currentTick = nowTick;
+    }
+}
+
+void TimerWheel::clear()
+{
+    for (QVector<Entry> &slot : m_slots) {
+        slot.clear();
+    }
+    m_size = 0;
+}
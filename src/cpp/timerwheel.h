@@ -0,0 +1,42 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QElapsedTimer>
+
+// 哈希时间轮
+// 定时器按到期tick散列到槽位，插入O(1)；每推进一个tick只检查一个槽位，
+// 超过一圈的定时器记录剩余圈数。取消是惰性的：到期时由调用方确认键是否仍然有效
+class TimerWheel
+{
+public:
+    // tickMs为精度，slotCount向上取整为2的幂
+    explicit TimerWheel(int tickMs = 100, int slotCount = 512);
+
+    // delayMs后到期，精度为一个tick，不会提前触发
+    void schedule(quint64 key, int delayMs);
+    // 推进到当前时间，把到期的键追加到expired
+    void advance(QVector<quint64> *expired);
+    void clear();
+
+    bool isEmpty() const { return m_size == 0; }
+    int size() const { return m_size; }
+    int tickMs() const { return m_tickMs; }
+
+private:
+    struct Entry
+    {
+        quint64 key;
+        int rounds; // 还需转过的圈数
+    };
+
+    QElapsedTimer m_clock;
+    QVector<QVector<Entry>> m_slots;
+    int m_mask;
+    int m_tickMs;
+    qint64 m_currentTick;
+    int m_size;
+};
+
+#endif // TIMERWHEEL_H
@@ -0,0 +1,189 @@
+#include "transport.h"
+#include <QTimer>
+
+TransportEndpoint TransportEndpoint::tcp(const QString &host, quint16 port)
+{
+    TransportEndpoint endpoint;
+    endpoint.kind = Kind::Tcp;
+    endpoint.host = host;
+    endpoint.port = port;
+    return endpoint;
+}
+
+TransportEndpoint TransportEndpoint::local(const QString &name)
+{
+    TransportEndpoint endpoint;
+    endpoint.kind = Kind::Local;
+    endpoint.localName = name;
+    return endpoint;
+}
+
+TransportEndpoint TransportEndpoint::inherited(qintptr descriptor, const QString &fallbackLocalName)
+{
+    TransportEndpoint endpoint;
+    endpoint.kind = Kind::Descriptor;
+    endpoint.descriptor = descriptor;
+    endpoint.localName = fallbackLocalName;
+    return endpoint;
+}
+
+Transport *Transport::create(const TransportEndpoint &endpoint, QObject *parent)
+{
+    switch (endpoint.kind) {
+    case TransportEndpoint::Kind::Local:
+        return new LocalTransport(endpoint.localName, -1, parent);
+    case TransportEndpoint::Kind::Descriptor:
+        return new LocalTransport(endpoint.localName, endpoint.descriptor, parent);
+    case TransportEndpoint::Kind::Tcp:
+        break;
+    }
+    return new TcpTransport(endpoint.host, endpoint.port, parent);
+}
+
+TcpTransport::TcpTransport(const QString &host, quint16 port, QObject *parent)
+    : Transport(parent)
+    , m_socket(this)
+    , m_host(host)
+    , m_port(port)
+{
+    connect(&m_socket, &QTcpSocket::connected, this, &Transport::connected);
+    connect(&m_socket, &QTcpSocket::disconnected, this, &Transport::disconnected);
+    connect(&m_socket, &QAbstractSocket::errorOccurred, this, &Transport::errorOccurred);
+}
+
+void TcpTransport::open()
+{
+    m_socket.connectToHost(m_host, m_port);
+}
+
+void TcpTransport::close()
+{
+    m_socket.disconnectFromHost();
+}
+
+void TcpTransport::abort()
+{
+    m_socket.abort();
+}
+
+bool TcpTransport::isConnected() const
+{
+    return m_socket.state() == QAbstractSocket::ConnectedState;
+}
+
+bool TcpTransport::isClosed() const
+{
+    return m_socket.state() == QAbstractSocket::UnconnectedState;
+}
+
+bool TcpTransport::waitForDisconnected(int msecs)
+{
+    return m_socket.waitForDisconnected(msecs);
+}
+
+qint64 TcpTransport::bytesToWrite() const
+{
+    return m_socket.bytesToWrite();
+}
+
+QString TcpTransport::errorString() const
+{
+    return m_socket.errorString();
+}
+
+QString TcpTransport::description() const
+{
+    return QString("%1:%2").arg(m_host).arg(m_port);
+}
+
+LocalTransport::LocalTransport(const QString &name, qintptr descriptor, QObject *parent)
+    : Transport(parent)
+    , m_socket(this)
+    , m_name(name)
+    , m_descriptor(descriptor)
+{
+    connect(&m_socket, &QLocalSocket::connected, this, &Transport::connected);
+    connect(&m_socket, &QLocalSocket::disconnected, this, &Transport::disconnected);
+    connect(&m_socket, &QLocalSocket::errorOccurred, this, [this]() {
+        m_errorString.clear();
+        emit errorOccurred();
+    });
+}
+
+void LocalTransport::open()
+{
+    m_errorString.clear();
+    if (m_descriptor >= 0) {
+        // 描述符在socket关闭时一起关闭，之后只能改连本地地址
+        qintptr descriptor = m_descriptor;
+        m_descriptor = -1;
+        if (!m_socket.setSocketDescriptor(descriptor)) {
+            failLater("无效的连接描述符");
+            return;
+        }
+        // setSocketDescriptor不发出connected，与其他方式一样在下一轮事件循环通知
+        QTimer::singleShot(0, this, [this]() {
+            if (isConnected()) {
+                emit connected();
+            }
+        });
+        return;
+    }
+    if (m_name.isEmpty()) {
+        failLater("连接描述符已使用，没有可重连的本地地址");
+        return;
+    }
+    m_socket.connectToServer(m_name);
+}
+
+void LocalTransport::close()
+{
+    m_socket.disconnectFromServer();
+}
+
+void LocalTransport::abort()
+{
+    m_socket.abort();
+}
+
+bool LocalTransport::isConnected() const
+{
+    return m_socket.state() == QLocalSocket::ConnectedState;
+}
+
+bool LocalTransport::isClosed() const
+{
+    return m_socket.state() == QLocalSocket::UnconnectedState;
+}
+
+bool LocalTransport::waitForDisconnected(int msecs)
+{
+    return m_socket.waitForDisconnected(msecs);
+}
+
+qint64 LocalTransport::bytesToWrite() const
+{
+    return m_socket.bytesToWrite();
+}
+
+QString LocalTransport::errorString() const
+{
+    return m_errorString.isEmpty() ? m_socket.errorString() : m_errorString;
+}
+
+QString LocalTransport::description() const
+{
+    if (m_descriptor >= 0) {
+        return QString("fd %1").arg(m_descriptor);
+    }
+    return m_name;
+}
+
+// 与socket的错误一样在下一轮事件循环通知
+void LocalTransport::failLater(const QString &message)
+{
+    QTimer::singleShot(0, this, [this, message]() {
+        m_errorString = message;
+        emit errorOccurred();
+    });
+}
@@ -0,0 +1,115 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <QObject>
+#include <QIODevice>
+#include <QString>
+#include <QTcpSocket>
+#include <QLocalSocket>
+
+// 连接地址
+struct TransportEndpoint
+{
+    enum class Kind {
+        Tcp,        // TCP，host:port
+        Local,      // 本地套接字：Unix域套接字路径或Windows命名管道名
+        Descriptor  // 启动子进程时继承给它的socketpair，本端的文件描述符
+    };
+
+    Kind kind = Kind::Tcp;
+    QString host;
+    quint16 port = 0;
+    // Local的地址；Descriptor的描述符用过一次后（断开重连）改连这个地址
+    QString localName;
+    qintptr descriptor = -1;
+    // 与子进程共享的内存环形缓冲区（SharedRing）的描述符，不属于连接地址本身；
+    // 描述符仍归创建方，客户端第一次连接时映射，之后的重连沿用
+    qintptr sharedMemoryDescriptor = -1;
+
+    static TransportEndpoint tcp(const QString &host, quint16 port);
+    static TransportEndpoint local(const QString &name);
+    static TransportEndpoint inherited(qintptr descriptor, const QString &fallbackLocalName = QString());
+};
+
+// 传输层，TcpClient只通过这个接口收发字节
+// 信号与QAbstractSocket相同：连接成功发出connected，已连接后断开发出disconnected，出错发出errorOccurred
+class Transport : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Transport(QObject *parent = nullptr) : QObject(parent) {}
+
+    static Transport *create(const TransportEndpoint &endpoint, QObject *parent);
+
+    virtual QIODevice *device() = 0;
+    // 异步连接
+    virtual void open() = 0;
+    // 写完剩余数据后断开
+    virtual void close() = 0;
+    // 立即断开，丢弃未写出的数据
+    virtual void abort() = 0;
+    virtual bool isConnected() const = 0;
+    virtual bool isClosed() const = 0;
+    virtual bool waitForDisconnected(int msecs) = 0;
+    virtual qint64 bytesToWrite() const = 0;
+    virtual QString errorString() const = 0;
+    // 日志中显示的地址
+    virtual QString description() const = 0;
+
+signals:
+    void connected();
+    void disconnected();
+    void errorOccurred();
+};
+
+class TcpTransport : public Transport
+{
+    Q_OBJECT
+public:
+    TcpTransport(const QString &host, quint16 port, QObject *parent = nullptr);
+
+    QIODevice *device() override { return &m_socket; }
+    void open() override;
+    void close() override;
+    void abort() override;
+    bool isConnected() const override;
+    bool isClosed() const override;
+    bool waitForDisconnected(int msecs) override;
+    qint64 bytesToWrite() const override;
+    QString errorString() const override;
+    QString description() const override;
+
+private:
+    QTcpSocket m_socket;
+    QString m_host;
+    quint16 m_port;
+};
+
+// Unix域套接字/Windows命名管道，或者继承的socketpair
+class LocalTransport : public Transport
+{
+    Q_OBJECT
+public:
+    LocalTransport(const QString &name, qintptr descriptor = -1, QObject *parent = nullptr);
+
+    QIODevice *device() override { return &m_socket; }
+    void open() override;
+    void close() override;
+    void abort() override;
+    bool isConnected() const override;
+    bool isClosed() const override;
+    bool waitForDisconnected(int msecs) override;
+    qint64 bytesToWrite() const override;
+    QString errorString() const override;
+    QString description() const override;
+
+private:
+    void failLater(const QString &message);
+
+    QLocalSocket m_socket;
+    QString m_name;
+    qintptr m_descriptor; // 只能使用一次，用过后置为-1
+    QString m_errorString;
+};
+
+#endif // TRANSPORT_H
@@ -2,28 +2,64 @@
 #include "ui_mainwindow.h"
 #include <QMessageBox>
 #include <QDateTime>
+#include <QTextDocument>
+#include "../messages.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , m_isConnected(false)
+    , m_commandRequestId(0)
 {
     ui->setupUi(this);
+    m_serverEndpoint = TransportEndpoint::tcp(SERVER_HOST, SERVER_PORT);
     
-    // 创建TCP客户端
-    m_tcpClient = new TcpClient(this);
+    // 日志区域只保留最近的记录，避免长时间运行后追加越来越慢
+    ui->textLog->document()->setMaximumBlockCount(MAX_LOG_LINES);
     
-    // 连接信号与槽
-    connect(m_tcpClient, &TcpClient::connected, this, &MainWindow::onTcpConnected);
-    connect(m_tcpClient, &TcpClient::disconnected, this, &MainWindow::onTcpDisconnected);
-    connect(m_tcpClient, &TcpClient::error, this, &MainWindow::onTcpError);
-    connect(m_tcpClient, &TcpClient::logMessage, this, &MainWindow::onTcpLogMessage);
+    // 创建TCP客户端，收发和解析在网络线程进行，界面日志只显示连接状态和请求事件
+    m_tcpClient = new ThreadedTcpClient(this);
+    m_tcpClient->setLogLevel(TcpClient::LogLevel::Info);
+    // 大消息（对话历史、截图）压缩发送，未编译LZ4时回退到deflate
+    m_tcpClient->setCompression(Protocol::CompressionCodec::Lz4);
+    // Node子进程重启后自动重连
+    m_tcpClient->setAutoReconnect(true);
+    // 每5秒一次心跳，连续3次没有回复说明Node事件循环卡住
+    m_tcpClient->setHeartbeat(5000, 3);
     
+    // 连接信号与槽
+    connect(m_tcpClient, &ThreadedTcpClient::connected, this, &MainWindow::onTcpConnected);
+    connect(m_tcpClient, &ThreadedTcpClient::disconnected, this, &MainWindow::onTcpDisconnected);
+    connect(m_tcpClient, &ThreadedTcpClient::error, this, &MainWindow::onTcpError);
+    connect(m_tcpClient, &ThreadedTcpClient::logMessage, this, &MainWindow::onTcpLogMessage);
+    connect(m_tcpClient, &ThreadedTcpClient::stateChanged, this, [this](TcpClient::ConnectionState state) {
+        if (state == TcpClient::ConnectionState::Reconnecting) {
+            ui->labelStatus->setText("正在重连...");
+        }
+    });
+    connect(m_tcpClient, &ThreadedTcpClient::peerUnresponsive, this, [this]() {
+        ui->labelStatus->setText("服务器无响应");
+    });
+    connect(m_tcpClient, &ThreadedTcpClient::peerRecovered, this, &MainWindow::updateConnectionStatus);
+
+    // 服务器推送的Agent进度
+    m_tcpClient->on<ThoughtStart>([this](const ThoughtStart &) {
+        appendToLog("Agent开始执行");
+    });
+    m_tcpClient->on<ThoughtEnd>([this](const ThoughtEnd &) {
+        appendToLog("Agent执行结束");
+    });
+    m_tcpClient->on<AgentMessage>([this](const AgentMessage &message) {
+        if (!message.data.conclusion.isEmpty()) {
+            appendToLog("Agent: " + message.data.conclusion);
+        }
+    });
+    m_tcpClient->on<AgentError>([this](const AgentError &message) {
+        appendToLog("Agent出错" + (message.message.isEmpty() ? QString() : ": " + message.message));
+    });
+
     // 初始化UI状态
     updateConnectionStatus();
-    
-    // 连接打开浏览器按钮
-    connect(ui->btnOpenBrowser, &QPushButton::clicked, this, &MainWindow::on_btnOpenBrowser_clicked);
 }
 
 MainWindow::~MainWindow()
@@ -31,15 +67,23 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+void MainWindow::setServerEndpoint(const TransportEndpoint &endpoint)
+{
+    m_serverEndpoint = endpoint;
+}
+
 void MainWindow::on_btnConnect_clicked()
 {
     if (!m_isConnected) {
         // 连接到服务器
         appendToLog("正在连接到服务器...");
-        if (m_tcpClient->connectToServer(SERVER_HOST, SERVER_PORT)) {
-            // 连接成功由信号处理
-        } else {
-            onTcpError("连接服务器失败");
+        // 连接结果由connected/error信号处理
+        m_tcpClient->connectToServer(m_serverEndpoint);
+        // 继承的描述符只能使用一次，之后改连本地套接字
+        if (m_serverEndpoint.kind == TransportEndpoint::Kind::Descriptor) {
+            m_serverEndpoint = m_serverEndpoint.localName.isEmpty()
+                ? TransportEndpoint::tcp(SERVER_HOST, SERVER_PORT)
+                : TransportEndpoint::local(m_serverEndpoint.localName);
         }
     } else {
         // 断开连接
@@ -82,12 +126,11 @@ void MainWindow::on_btnCalculate_clicked()
     int b = ui->spinNum2->value();
     
     // 构建计算请求的JSON字符串
-    QJsonObject calcData;
-    calcData["a"] = a;
-    calcData["b"] = b;
-    calcData["operation"] = "add";
-    QJsonDocument calcDoc(calcData);
-    QString calcJson = calcDoc.toJson(QJsonDocument::Compact);
+    CalculateRequest calcData;
+    calcData.a = a;
+    calcData.b = b;
+    calcData.operation = "add";
+    QString calcJson = QString::fromUtf8(Schema::toJson(calcData));
     
     // 直接发送JSON字符串，不使用{event, data}包装
     m_tcpClient->sendDirectMessage(calcJson, [this, a, b](const QJsonObject &response) {
@@ -110,6 +153,7 @@ void MainWindow::onTcpConnected()
 void MainWindow::onTcpDisconnected()
 {
     m_isConnected = false;
+    setCommandRunning(0);
     updateConnectionStatus();
     appendToLog("已断开与服务器的连接");
 }
@@ -154,13 +198,37 @@ void MainWindow::on_btnOpenBrowser_clicked()
         return;
     }
     
+    if (m_commandRequestId != 0) {
+        appendToLog("上一条指令仍在执行");
+        return;
+    }
+    
     // 发送执行命令请求（使用正确的协议格式）
     appendToLog("发送execute_command请求...");
     
-    m_tcpClient->sendExecuteCommand("browser", "帮我打开boss直聘并登录", [this](const QJsonObject &response) {
+    // 执行结束、取消或断开时回调收到响应
+    RequestId requestId = m_tcpClient->sendExecuteCommand("browser", "帮我打开boss直聘并登录", [this](const QJsonObject &response) {
+        setCommandRunning(0);
         appendToLog("收到execute_command响应: " + QString(QJsonDocument(response).toJson(QJsonDocument::Compact)));
         if (response.contains("status")) {
             appendToLog("执行状态: " + response["status"].toString());
         }
     });
+    setCommandRunning(requestId);
+}
+
+void MainWindow::on_btnStopCommand_clicked()
+{
+    if (m_commandRequestId == 0) {
+        return;
+    }
+    // 取消请求，Node端停止执行该指令的Agent
+    appendToLog("停止执行...");
+    m_tcpClient->cancel(m_commandRequestId);
+}
+
+void MainWindow::setCommandRunning(RequestId requestId)
+{
+    m_commandRequestId = requestId;
+    ui->btnStopCommand->setEnabled(requestId != 0);
 }
\ No newline at end of file
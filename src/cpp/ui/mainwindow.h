@@ -2,7 +2,7 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include "../tcpclient.h"
+#include "../threadedtcpclient.h"
 
 namespace Ui {
 class MainWindow;
@@ -16,11 +16,15 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // 服务器地址，默认TCP的SERVER_HOST:SERVER_PORT；内嵌Node时使用本地连接
+    void setServerEndpoint(const TransportEndpoint &endpoint);
+
 private slots:
     void on_btnConnect_clicked();
     void on_btnSendMessage_clicked();
     void on_btnCalculate_clicked();
     void on_btnOpenBrowser_clicked();
+    void on_btnStopCommand_clicked();
 
     void onTcpConnected();
     void onTcpDisconnected();
@@ -30,14 +34,21 @@ private slots:
 private:
     void updateConnectionStatus();
     void appendToLog(const QString &message);
+    void setCommandRunning(RequestId requestId);
 
     Ui::MainWindow *ui;
-    TcpClient *m_tcpClient;
+    ThreadedTcpClient *m_tcpClient;
     bool m_isConnected;
+    TransportEndpoint m_serverEndpoint;
+    // 正在执行的execute_command请求，0表示没有
+    RequestId m_commandRequestId;
 
     // 服务器地址和端口
     const QString SERVER_HOST = "localhost";
     const quint16 SERVER_PORT = 8888;
+
+    // 日志区域保留的最大行数
+    static const int MAX_LOG_LINES = 2000;
 };
 
 #endif // MAINWINDOW_H 
\ No newline at end of file
@@ -12,13 +12,16 @@ class AgentMessageServer {
 
   private socket: any;
 
+  // 正在执行的指令对应的请求ID，客户端取消该请求时停止Agent
+  private runningRequestId?: number;
+
   constructor () {
     // 初始化时生成会话ID
     this.generateSessionId();
     
     this.agent = new AgentServer({
       onData: (e) => {
-        this.socket.emit('agent_message', e)
+        this.emitAgentMessage(e)
       },
       onError: (e) => {
         this.socket.emit('agent_error', e)
@@ -110,6 +113,42 @@ class AgentMessageServer {
     return parseProfiles();
   }
 
+  // 客户端支持图片负载时，截图以二进制帧单独分块发送，agent_message中只保留screenshotId
+  private emitAgentMessage (e: any) {
+    const conversations = e?.data?.conversations;
+    if (!Array.isArray(conversations) || !this.socket.supportsPayloadType?.('I')) {
+      this.socket.emit('agent_message', e);
+      return;
+    }
+
+    const screenshots: { screenshotId: string, base64: string }[] = [];
+    const stripped = conversations.map((conv: any) => {
+      if (!conv?.screenshotBase64) {
+        return conv;
+      }
+      const { screenshotBase64, ...rest } = conv;
+      const screenshotId = createUniqueID();
+      screenshots.push({ screenshotId, base64: screenshotBase64 });
+      return { ...rest, screenshotId };
+    });
+
+    this.socket.emit('agent_message', { ...e, data: { ...e.data, conversations: stripped } });
+    screenshots.forEach(({ screenshotId, base64 }) => {
+      const image = Buffer.from(base64.replace(/^data:image\/\w+;base64,/, ''), 'base64');
+      this.socket.emitStream('agent_screenshot', image, { data: { screenshotId } }, 'I');
+    });
+  }
+
+  // 旧版客户端把指令作为JSON字符串放在data中，无法解析时忽略
+  private parseCommand (data: string) {
+    try {
+      return JSON.parse(data);
+    } catch (error) {
+      console.error('解析execute_command失败:', (error as Error).message);
+      return undefined;
+    }
+  }
+
   emitThoughtStart () {
     this.socket.emit('thought-start')
   }
@@ -160,33 +199,54 @@ class AgentMessageServer {
 
   listen (socket: any) {
     this.socket = socket;
-    this.socket.on('execute_command', async (data: string) => {
-      this.onExecuteCommand(JSON.parse(data))
+    // 执行结束后以同一个requestId回复command_finished；请求已被取消时不回复
+    this.socket.on('execute_command', async (data: any, _binary?: Buffer, requestId?: number) => {
+      this.runningRequestId = requestId;
+      try {
+        await this.onExecuteCommand(typeof data === 'string' ? this.parseCommand(data) : data);
+      } finally {
+        if (this.runningRequestId === requestId) {
+          this.runningRequestId = undefined;
+          if (requestId !== undefined) {
+            this.socket.emit('command_finished', undefined, requestId);
+          }
+        }
+      }
     })
 
+    // 客户端放弃了请求：正在执行的指令由该请求发起时停止Agent，不再回复
+    socket.on('cancel_request', (data: any) => {
+      if (data?.requestId === undefined || data.requestId !== this.runningRequestId) {
+        return;
+      }
+      this.runningRequestId = undefined;
+      this.agent?.stop?.();
+      this.clearSession();
+    });
+
     // 心跳检测
-    socket.on('node_detect', () => {
-      this.socket.emit('heartbeat')
+    socket.on('node_detect', (_data: any, _binary?: Buffer, requestId?: number) => {
+      this.socket.emit('heartbeat', undefined, requestId)
     })
 
     // 处理停止代理
-    socket.on('stop_agent', () => {
+    socket.on('stop_agent', (_data: any, _binary?: Buffer, requestId?: number) => {
       this.agent?.stop?.();
       // 停止时清除会话ID
       this.clearSession();
-      this.socket.emit('agent_stopped');
+      this.socket.emit('agent_stopped', undefined, requestId);
     });
 
     // 处理暂停代理
-    socket.on('pause_agent', () => {
+    socket.on('pause_agent', (_data: any, _binary?: Buffer, requestId?: number) => {
       this.agent.pause();
-      this.socket.emit('agent_paused');
+      this.socket.emit('agent_paused', undefined, requestId);
     });
 
     // 处理恢复代理
-    socket.on('resume_agent', () => {
+    socket.on('resume_agent', (_data: any, _binary?: Buffer, requestId?: number) => {
       this.agent.resume();
-      this.socket.emit('agent_resumed');
+      this.socket.emit('agent_resumed', undefined, requestId);
     });
 
     socket.on('disconnect', () => {
@@ -1,6 +1,12 @@
 import * as net from 'net';
+import * as fs from 'fs';
+import * as zlib from 'zlib';
+import { monitorEventLoopDelay } from 'perf_hooks';
 import * as dotenv from 'dotenv';
 import AgentMessageServer from './message';
+import { crc32c } from './utils/crc32c';
+import { lz4CompressBlock, lz4DecompressBlock } from './utils/lz4';
+import { SharedRing } from './utils/shared-ring';
 
 // 加载环境变量
 dotenv.config();
@@ -10,99 +16,668 @@ const server = net.createServer();
 
 const HOST = '127.0.0.1';
 const PORT = 8888;
+// 内嵌运行时父进程传入的本地连接方式：继承的socketpair描述符、本地套接字路径（Windows上是命名管道）
+const IPC_FD = process.env.AGENT_IPC_FD;
+const IPC_PATH = process.env.AGENT_IPC_PATH;
+// 内嵌运行时父进程传入的共享内存，声明支持'S'的客户端映射了同一块内存
+const SHARED_RING_FD = process.env.AGENT_SHM_FD;
+const sharedRing = SHARED_RING_FD ? SharedRing.open(Number(SHARED_RING_FD)) : null;
+// 共享内存同时只给一个连接使用
+let sharedRingOwner: net.Socket | null = null;
+
+// 类型字段：[负载类型][标志位]，标志位最高位为0时是旧版的'0'（SHA-256校验）
+const PAYLOAD_JSON = 0x30;
+// 二进制负载：[4字节元数据长度][元数据JSON][二进制数据]
+const PAYLOAD_BINARY = 0x42; // 'B'
+const PAYLOAD_IMAGE = 0x49;  // 'I'
+const BINARY_PAYLOAD_TYPES = [PAYLOAD_BINARY, PAYLOAD_IMAGE];
+// 分块负载：[4字节流ID][4字节序号][1字节分块标志][分块数据]
+// 序号0的分块数据以[4字节元数据长度][元数据JSON]开头，元数据描述整个流
+const PAYLOAD_CHUNK = 0x43;  // 'C'
+const CHUNK_HEADER_SIZE = 9;
+const CHUNK_FINAL = 0x01;
+const CHUNK_SIZE = 64 * 1024;
+// 批量负载：若干条[4字节长度][JSON消息]首尾相接
+const PAYLOAD_BATCH = 0x4d;  // 'M'
+// 共享内存描述符负载：[4字节元数据长度][元数据JSON][1字节实际负载类型][4字节位置][4字节长度]
+const PAYLOAD_SHARED = 0x53; // 'S'
+// 小于该大小的负载直接通过连接发送
+const SHARED_RING_MIN_SIZE = 64 * 1024;
+// 本端能接收的负载类型，回复给客户端
+const SUPPORTED_PAYLOAD_TYPES = ['B', 'I', 'C', 'M'];
+// 标志位最高位为1时：bit0-1校验模式，bit2-3压缩算法
+const LEGACY_FLAGS = 0x30;
+const FLAG_EXTENDED = 0x80;
+const CHECKSUM_MODE_MASK = 0x03;
+const COMPRESSION_SHIFT = 2;
+const COMPRESSION_MASK = 0x0c;
+const RESERVED_FLAGS_MASK = 0x70;
+// 同步标记：协议版本2起每帧以它开头，[0xA5 0x5A][4字节长度][2字节类型][负载][4字节校验]，不在校验范围内
+// 旧版帧以长度开头，第1字节不会是0xA5，逐帧区分两种格式；数据损坏时跳到下一个标记重新分帧
+const SYNC_MARKER = Buffer.from([0xa5, 0x5a]);
+const SYNC_MARKER_VERSION = 2;
+
+enum ChecksumMode {
+  Sha256 = 0,
+  Crc32c = 1,
+}
+
+// 压缩后的负载：[4字节原始长度][压缩数据]，与C++端qCompress的输出一致
+enum CompressionCodec {
+  None = 0,
+  Deflate = 1,
+  Lz4 = 2,
+  Zstd = 3,
+}
+
+const COMPRESSION_NAMES: Record<string, CompressionCodec> = {
+  deflate: CompressionCodec.Deflate,
+  lz4: CompressionCodec.Lz4,
+  zstd: CompressionCodec.Zstd,
+};
+
+// 发送端的编码参数，由客户端的协商请求决定
+interface FrameEncoding {
+  checksum: ChecksumMode;
+  compression: CompressionCodec;
+  threshold: number;
+  // 写入时在帧前加同步标记，握手确定版本2后开启
+  syncMarker: boolean;
+}
+
+// 解压后负载的上限，握手时作为maxFrameSize告知客户端
+const MAX_PAYLOAD_SIZE = 256 * 1024 * 1024;
+// 负载上限针对数据本身，线上长度另外允许元数据、分块头和压缩头的余量
+const PAYLOAD_HEADROOM = 64 * 1024;
+// 协议版本，握手时与客户端的版本取较小值；2起帧前加同步标记
+const PROTOCOL_VERSION = 2;
+
+// 事件循环延迟，随心跳的pong上报给客户端；Agent阻塞事件循环时pong本身也会延迟，客户端据此判断无响应
+const loopDelay = monitorEventLoopDelay({ resolution: 20 });
+loopDelay.enable();
+
+// zstd由Node.js自带的zlib提供（22.15/23.8起），更早的版本不参与协商；LZ4使用utils/lz4.ts的块格式实现
+const zstd = zlib as any;
+const ZSTD_AVAILABLE = typeof zstd.zstdCompressSync === 'function';
+
+function _isCodecAvailable(codec: CompressionCodec) {
+  return codec === CompressionCodec.Deflate || codec === CompressionCodec.Lz4
+    || (codec === CompressionCodec.Zstd && ZSTD_AVAILABLE);
+}
+
+function _compressBody(data: Buffer, codec: CompressionCodec): Buffer {
+  switch (codec) {
+    case CompressionCodec.Lz4:
+      return lz4CompressBlock(data);
+    case CompressionCodec.Zstd:
+      return zstd.zstdCompressSync(data);
+    default:
+      return zlib.deflateSync(data, { level: 1 });
+  }
+}
+
+function _compress(data: Buffer, codec: CompressionCodec) {
+  const compressed = _compressBody(data, codec);
+  const out = Buffer.allocUnsafe(4 + compressed.length);
+  out.writeUInt32BE(data.length, 0);
+  compressed.copy(out, 4);
+  return out;
+}
+
+function _decompress(payload: Buffer, codec: CompressionCodec) {
+  if (payload.length < 4) {
+    return null;
+  }
+  const originalLength = payload.readUInt32BE(0);
+  if (originalLength > MAX_PAYLOAD_SIZE || !_isCodecAvailable(codec)) {
+    return null;
+  }
+  const compressed = payload.subarray(4);
+  try {
+    let out: Buffer | null;
+    if (codec === CompressionCodec.Lz4) {
+      out = lz4DecompressBlock(compressed, originalLength);
+    } else if (codec === CompressionCodec.Zstd) {
+      out = zstd.zstdDecompressSync(compressed);
+    } else {
+      out = zlib.inflateSync(compressed, { maxOutputLength: Math.max(originalLength, 1) });
+    }
+    return out && out.length === originalLength ? out : null;
+  } catch (err) {
+    return null;
+  }
+}
 
 function _calculateCRC32(data: Buffer) {
-  // 实际应用中应使用专业的CRC32算法
+  // 旧版校验：SHA-256的前4字节
   const crypto = require('crypto');
   const hash = crypto.createHash('sha256').update(data).digest();
   return hash.readUInt32BE(0);
 }
 
-// 当有新客户端连接时
-server.on('connection', (socket: net.Socket) => {
-  console.log(`C++客户端已连接: ${socket.remoteAddress}:${socket.remotePort}`);
+function _calculateChecksum(data: Buffer, mode: ChecksumMode) {
+  return mode === ChecksumMode.Crc32c ? crc32c(data) : _calculateCRC32(data);
+}
+
+function _makeFlags(mode: ChecksumMode, codec: CompressionCodec) {
+  if (mode === ChecksumMode.Sha256 && codec === CompressionCodec.None) {
+    return LEGACY_FLAGS;
+  }
+  return FLAG_EXTENDED | mode | (codec << COMPRESSION_SHIFT);
+}
+
+function _compressionFromFlags(flags: number): CompressionCodec {
+  return flags & FLAG_EXTENDED ? (flags & COMPRESSION_MASK) >> COMPRESSION_SHIFT : CompressionCodec.None;
+}
+
+// 根据标志位得到校验模式，未知模式返回null
+function _checksumModeFromFlags(flags: number): ChecksumMode | null {
+  if (!(flags & FLAG_EXTENDED)) {
+    return ChecksumMode.Sha256;
+  }
+  const mode = flags & CHECKSUM_MODE_MASK;
+  return mode <= ChecksumMode.Crc32c ? mode : null;
+}
+
+// 标志位是否是合法取值，重新同步时用来排除数据中偶然出现的同步标记
+function _isWellFormedFlags(flags: number) {
+  return flags === LEGACY_FLAGS
+    || ((flags & FLAG_EXTENDED) !== 0 && (flags & RESERVED_FLAGS_MASK) === 0 && _checksumModeFromFlags(flags) !== null);
+}
+
+// 对端发来的JSON，解析失败或不是对象时返回null，由调用方记录后丢弃
+function _parseJsonObject(data: Buffer) {
+  try {
+    const obj = JSON.parse(data.toString());
+    return obj !== null && typeof obj === 'object' ? obj : null;
+  } catch (err) {
+    return null;
+  }
+}
+
+// 拆分二进制负载[4字节元数据长度][元数据JSON][二进制数据]，长度越界或元数据无效时返回null
+function _splitBinaryPayload(payload: Buffer) {
+  if (payload.length < 4) {
+    return null;
+  }
+  const metaLength = payload.readUInt32BE(0);
+  if (metaLength > payload.length - 4) {
+    return null;
+  }
+  const meta = _parseJsonObject(payload.subarray(4, 4 + metaLength));
+  return meta ? { meta, data: payload.subarray(4 + metaLength) } : null;
+}
+
+// 编码一帧：[4字节长度][2字节类型][负载][4字节校验]
+// 负载由若干段组成，预先分配整帧大小，各段直接写入帧内，校验在原地计算
+// 超过阈值的负载整体压缩，压缩后没有变小则按原样发送
+function _encodeFrame(payloadType: number, parts: (Buffer | string)[], encoding: FrameEncoding) {
+  let body: Buffer[] = parts.map((part) => typeof part === 'string' ? Buffer.from(part) : part);
+  let payloadLength = body.reduce((sum, part) => sum + part.length, 0);
+  let codec = CompressionCodec.None;
+  if (encoding.compression !== CompressionCodec.None && payloadLength >= encoding.threshold) {
+    const compressed = _compress(Buffer.concat(body, payloadLength), encoding.compression);
+    if (compressed.length < payloadLength) {
+      body = [compressed];
+      payloadLength = compressed.length;
+      codec = encoding.compression;
+    }
+  }
+
+  const frame = Buffer.allocUnsafe(10 + payloadLength);
+  frame.writeUInt32BE(payloadLength, 0);
+  frame[4] = payloadType;
+  frame[5] = _makeFlags(encoding.checksum, codec);
+  let offset = 6;
+  body.forEach((part) => {
+    offset += part.copy(frame, offset);
+  });
+  frame.writeUInt32BE(_calculateChecksum(frame.subarray(4, 6 + payloadLength), encoding.checksum), 6 + payloadLength);
+  return frame;
+}
+
+// 编码二进制帧：[4字节元数据长度][元数据JSON][二进制数据]，二进制数据不做base64编码
+function _encodeBinaryFrame(payloadType: number, meta: object, data: Buffer, encoding: FrameEncoding) {
+  const metaBuf = Buffer.from(JSON.stringify(meta));
+  const metaLength = Buffer.allocUnsafe(4);
+  metaLength.writeUInt32BE(metaBuf.length, 0);
+  return _encodeFrame(payloadType, [metaLength, metaBuf, data], encoding);
+}
+
+// 编码共享内存描述符帧，数据已写入共享内存
+function _encodeSharedFrame(payloadType: number, position: number, length: number, meta: object,
+                            encoding: FrameEncoding) {
+  const descriptor = Buffer.allocUnsafe(9);
+  descriptor[0] = payloadType;
+  descriptor.writeUInt32BE(position, 1);
+  descriptor.writeUInt32BE(length, 5);
+  return _encodeBinaryFrame(PAYLOAD_SHARED, meta, descriptor, encoding);
+}
+
+// 编码批量帧，每条消息前加4字节长度
+function _encodeBatchFrame(messages: string[], encoding: FrameEncoding) {
+  const parts: Buffer[] = [];
+  messages.forEach((message) => {
+    const body = Buffer.from(message);
+    const length = Buffer.allocUnsafe(4);
+    length.writeUInt32BE(body.length, 0);
+    parts.push(length, body);
+  });
+  return _encodeFrame(PAYLOAD_BATCH, parts, encoding);
+}
+
+// 编码分块帧，meta只在序号0的分块中携带
+function _encodeChunkFrame(streamId: number, sequence: number, final: boolean, meta: Buffer | null,
+                           data: Buffer, encoding: FrameEncoding) {
+  const header = Buffer.allocUnsafe(CHUNK_HEADER_SIZE + (meta ? 4 : 0));
+  header.writeUInt32BE(streamId, 0);
+  header.writeUInt32BE(sequence, 4);
+  header[8] = final ? CHUNK_FINAL : 0;
+  if (!meta) {
+    return _encodeFrame(PAYLOAD_CHUNK, [header, data], encoding);
+  }
+  header.writeUInt32BE(meta.length, CHUNK_HEADER_SIZE);
+  return _encodeFrame(PAYLOAD_CHUNK, [header, meta, data], encoding);
+}
+
+// 当有新客户端连接时，TCP、本地套接字和继承的socketpair共用
+const handleConnection = (socket: net.Socket) => {
+  console.log(`C++客户端已连接: ${socket.remoteAddress ? `${socket.remoteAddress}:${socket.remotePort}` : '本地连接'}`);
   let buffer: Buffer = Buffer.alloc(0);
+  // 发送使用的校验模式和压缩算法，由客户端的协商请求决定
+  const encoding: FrameEncoding = {
+    checksum: ChecksumMode.Sha256,
+    compression: CompressionCodec.None,
+    threshold: 4096,
+    syncMarker: false,
+  };
+  // 收到过带同步标记的帧，此后不带标记的位置都视为失步
+  let synced = false;
+  // 客户端通过握手或payload_types声明能接收的二进制负载类型
+  const peerPayloadTypes = new Set<number>();
+  // 客户端能接收的单帧负载上限，来自握手
+  let peerMaxPayloadSize = MAX_PAYLOAD_SIZE;
+  // 待发送的分块流，每次只写一个分块，其他消息可以插在分块之间
+  const outgoingStreams: { id: number, meta: Buffer, data: Buffer, offset: number, sequence: number }[] = [];
+  let nextStreamId = 1;
+  let waitingDrain = false;
+  // 接收中的分块流
+  const incomingStreams = new Map<number, { meta: any, nextSequence: number, parts: Buffer[], size: number }>();
+  // 同一轮事件循环内写出的帧合并为一次系统调用
+  let corked = false;
+  // 处理批量请求期间同步发出的消息，处理完后作为一个批量帧回复
+  let batchReplies: string[] | null = null;
+
+  const writeFrame = (frame: Buffer) => {
+    if (!corked) {
+      corked = true;
+      socket.cork();
+      process.nextTick(() => {
+        corked = false;
+        socket.uncork();
+      });
+    }
+    if (encoding.syncMarker) {
+      socket.write(SYNC_MARKER);
+    }
+    return socket.write(frame);
+  };
+
+  // 客户端映射了共享内存时，大负载写入共享内存，连接上只发描述符帧；返回false时由调用方通过连接发送
+  const emitShared = (meta: object, data: Buffer, payloadType: number) => {
+    if (!sharedRing || sharedRingOwner !== socket || data.length < SHARED_RING_MIN_SIZE) {
+      return false;
+    }
+    let position: number | null = null;
+    try {
+      position = sharedRing.write(data);
+    } catch (error) {
+      console.error('写入共享内存失败:', error);
+    }
+    if (position === null) {
+      return false;
+    }
+    writeFrame(_encodeSharedFrame(payloadType, position, data.length, meta, encoding));
+    return true;
+  };
+
+  // 轮流从各个流取一个分块写入socket，写缓冲区满时等待drain再继续
+  const pumpStreams = () => {
+    waitingDrain = false;
+    while (outgoingStreams.length > 0 && !socket.destroyed) {
+      const stream = outgoingStreams.shift()!;
+      const length = Math.min(CHUNK_SIZE, stream.data.length - stream.offset);
+      const final = stream.offset + length >= stream.data.length;
+      const frame = _encodeChunkFrame(stream.id, stream.sequence, final, stream.sequence === 0 ? stream.meta : null,
+        stream.data.subarray(stream.offset, stream.offset + length), encoding);
+      if (!final) {
+        stream.offset += length;
+        stream.sequence++;
+        outgoingStreams.push(stream);
+      }
+      if (!writeFrame(frame)) {
+        waitingDrain = true;
+        socket.once('drain', pumpStreams);
+        return;
+      }
+    }
+  };
+
+  // 处理分块帧，拼接完整后按普通二进制消息分发；序号不连续时丢弃整个流
+  const handleChunk = (payload: Buffer) => {
+    if (payload.length < CHUNK_HEADER_SIZE) {
+      return;
+    }
+    const streamId = payload.readUInt32BE(0);
+    const sequence = payload.readUInt32BE(4);
+    const final = (payload[8] & CHUNK_FINAL) !== 0;
+    let data = payload.subarray(CHUNK_HEADER_SIZE);
+    if (sequence === 0) {
+      // 第一个分块以元数据开头，格式与二进制负载相同
+      const first = _splitBinaryPayload(data);
+      if (!first) {
+        console.error(`解析分块元数据失败，丢弃流 ${streamId}`);
+        incomingStreams.delete(streamId);
+        return;
+      }
+      data = first.data;
+      incomingStreams.set(streamId, { meta: first.meta, nextSequence: 0, parts: [], size: 0 });
+    }
+    const stream = incomingStreams.get(streamId);
+    if (!stream || stream.nextSequence !== sequence) {
+      console.error(`分块序号不连续，丢弃流 ${streamId}`);
+      incomingStreams.delete(streamId);
+      return;
+    }
+    stream.nextSequence++;
+    stream.parts.push(Buffer.from(data));
+    stream.size += data.length;
+    if (stream.size > MAX_PAYLOAD_SIZE) {
+      console.error(`分块流超过上限，丢弃流 ${streamId}`);
+      incomingStreams.delete(streamId);
+      return;
+    }
+    if (final) {
+      incomingStreams.delete(streamId);
+      newSocket.exec(stream.meta.event, stream.meta.data, Buffer.concat(stream.parts, stream.size), stream.meta.requestId);
+    }
+  };
 
   const newSocket: any = {
     listeners: {},
-    emit: (event: string, data?: any) => {
+    // requestId不为空时随消息带回，客户端据此匹配请求回调
+    emit: (event: string, data?: any, requestId?: number) => {
       try {
         const payload = JSON.stringify({
           event: event,
           data: data,
+          requestId,
         })
-        const payloadBuf = Buffer.from(payload)
-        
-        const header = Buffer.alloc(4);
-        header.writeUInt32BE(payloadBuf.length);
-        const typeBuf = Buffer.from('00', 'ascii');
-        const crcBuf = Buffer.alloc(4);
-        const dataToCrc = Buffer.concat([typeBuf, payloadBuf]);
-        const crc = _calculateCRC32(dataToCrc);
-        crcBuf.writeUInt32BE(crc);
-  
-        const message = Buffer.concat([
-          header,
-          typeBuf,
-          payloadBuf,
-          crcBuf,
-        ]);
-        socket.write(message);
-        // socket.write(JSON.stringify({
-        //   event: "hide_window",
-        // }));
+        if (batchReplies) {
+          batchReplies.push(payload);
+          return;
+        }
+        writeFrame(_encodeFrame(PAYLOAD_JSON, [payload], encoding));
         return;
       } catch (error) {
         console.error('处理消息出错:', error);
       }
     },
-    on: (event: string, callback: (data: any) => any) => {
+    // 发送二进制负载，type为'B'或'I'；客户端不支持该类型时返回false，由调用方回退到JSON
+    emitBinary: (event: string, data: Buffer, meta: object = {}, type: 'B' | 'I' = 'B') => {
+      const payloadType = type.charCodeAt(0);
+      if (!peerPayloadTypes.has(payloadType)) {
+        return false;
+      }
+      // 超过客户端单帧上限时分块发送；超过一个分块的负载也分块发送，
+      // 之后的回复（如agent_stopped）只需等一个分块写出，不必排在整个大帧后面
+      if ((data.length >= peerMaxPayloadSize || data.length > CHUNK_SIZE) && peerPayloadTypes.has(PAYLOAD_CHUNK)) {
+        return newSocket.emitStream(event, data, meta, type);
+      }
+      try {
+        // 带上发出时间，客户端据此统计端到端耗时
+        const binaryMeta = { ...meta, event, sentAt: Date.now() };
+        if (!emitShared(binaryMeta, data, payloadType)) {
+          writeFrame(_encodeBinaryFrame(payloadType, binaryMeta, data, encoding));
+        }
+        return true;
+      } catch (error) {
+        console.error('处理消息出错:', error);
+        return false;
+      }
+    },
+    // 分块发送大负载，客户端不支持分块时整体发送
+    emitStream: (event: string, data: Buffer, meta: object = {}, type: 'B' | 'I' = 'B') => {
+      if (!peerPayloadTypes.has(PAYLOAD_CHUNK)) {
+        return newSocket.emitBinary(event, data, meta, type);
+      }
+      if (!peerPayloadTypes.has(type.charCodeAt(0))) {
+        return false;
+      }
+      if (emitShared({ ...meta, event, sentAt: Date.now() }, data, type.charCodeAt(0))) {
+        return true;
+      }
+      const streamMeta = { ...meta, event, type, size: data.length, sentAt: Date.now() };
+      outgoingStreams.push({ id: nextStreamId++, meta: Buffer.from(JSON.stringify(streamMeta)), data, offset: 0, sequence: 0 });
+      if (!waitingDrain) {
+        pumpStreams();
+      }
+      return true;
+    },
+    supportsPayloadType: (type: 'B' | 'I') => peerPayloadTypes.has(type.charCodeAt(0)),
+    on: (event: string, callback: (data: any, binary?: Buffer, requestId?: number) => any) => {
       newSocket.listeners[event] = callback;
     },
-    exec: (event: string, data?: any) => {
+    exec: (event: string, data?: any, binary?: Buffer, requestId?: number) => {
       if (newSocket.listeners[event]) {
-        newSocket.listeners[event](data);
+        newSocket.listeners[event](data, binary, requestId);
       }
     }
   }
   
+  // 记录客户端能接收的负载类型
+  const applyPeerPayloadTypes = (types: string[]) => {
+    types.forEach((t) => peerPayloadTypes.add(t.charCodeAt(0)));
+    // 客户端映射了共享内存，由这个连接接管，之前连接上未处理的数据作废
+    if (sharedRing && peerPayloadTypes.has(PAYLOAD_SHARED)) {
+      sharedRingOwner = socket;
+      sharedRing.reset();
+    }
+  };
+
+  // 客户端支持时使用CRC32C
+  const selectChecksum = (modes: string[]) => modes.includes('crc32c') ? ChecksumMode.Crc32c : ChecksumMode.Sha256;
+
+  // 按客户端的偏好顺序选第一个本端支持的算法
+  const selectCompression = (codecs: string[]) =>
+    codecs.find((c) => COMPRESSION_NAMES[c] !== undefined && _isCodecAvailable(COMPRESSION_NAMES[c]));
+
+  // 处理一条JSON消息，协议层事件在这里处理，其余交给监听函数；无法解析的消息记录后丢弃
+  const handleJsonMessage = (data: Buffer) => {
+    const obj = _parseJsonObject(data);
+    if (!obj) {
+      console.error('解析JSON消息失败，丢弃消息');
+      return;
+    }
+    if (obj.event === 'protocol_hello') {
+      // 握手：一次选定所有参数，回复使用当前编码发送，之后切换；旧版客户端仍逐项协商
+      const hello = obj.data || {};
+      const checksum = selectChecksum(hello.checksumModes || []);
+      const codec = selectCompression(hello.compressionCodecs || []);
+      applyPeerPayloadTypes(hello.payloadTypes || []);
+      peerMaxPayloadSize = hello.maxFrameSize > 0 ? hello.maxFrameSize : MAX_PAYLOAD_SIZE;
+      newSocket.emit('protocol_hello', {
+        version: Math.min(hello.version || 1, PROTOCOL_VERSION),
+        maxFrameSize: MAX_PAYLOAD_SIZE,
+        checksum: checksum === ChecksumMode.Crc32c ? 'crc32c' : 'sha256',
+        compression: codec || 'none',
+        payloadTypes: SUPPORTED_PAYLOAD_TYPES,
+      });
+      encoding.checksum = checksum;
+      encoding.compression = codec ? COMPRESSION_NAMES[codec] : CompressionCodec.None;
+      encoding.threshold = hello.threshold ?? encoding.threshold;
+      encoding.syncMarker = Math.min(hello.version || 1, PROTOCOL_VERSION) >= SYNC_MARKER_VERSION;
+    } else if (obj.event === 'ping') {
+      // 原样带回客户端的发送时刻，附上自上次pong以来事件循环延迟的最大值
+      const loopLagMs = loopDelay.max / 1e6;
+      loopDelay.reset();
+      newSocket.emit('pong', { seq: obj.data?.seq, t: obj.data?.t, loopLagMs });
+    } else if (obj.event === 'cancel_request') {
+      // 客户端取消请求：丢弃该请求未收完的分块流，再交给监听函数（AgentMessageServer据此停止Agent）
+      const requestId = obj.data?.requestId;
+      incomingStreams.forEach((stream, streamId) => {
+        if (stream.meta?.requestId === requestId) {
+          incomingStreams.delete(streamId);
+        }
+      });
+      newSocket.exec('cancel_request', obj.data);
+    } else if (obj.event === 'payload_types') {
+      applyPeerPayloadTypes(obj.data?.types || []);
+      newSocket.emit('payload_types', { types: SUPPORTED_PAYLOAD_TYPES });
+    } else if (obj.event === 'checksum_negotiate') {
+      // 回复使用当前模式发送，之后切换；客户端按帧标志位逐帧校验
+      const selected = selectChecksum(obj.data?.modes || []);
+      newSocket.emit('checksum_negotiate', { mode: selected === ChecksumMode.Crc32c ? 'crc32c' : 'sha256' });
+      encoding.checksum = selected;
+    } else if (obj.event === 'compression_negotiate') {
+      const name = selectCompression(obj.data?.codecs || []);
+      newSocket.emit('compression_negotiate', { codec: name || 'none' });
+      encoding.compression = name ? COMPRESSION_NAMES[name] : CompressionCodec.None;
+      encoding.threshold = obj.data?.threshold ?? encoding.threshold;
+    } else {
+      newSocket.exec(obj.event, obj.data, undefined, obj.requestId)
+    }
+  };
+
+  // 处理批量帧，逐条分发；期间同步发出的回复合并为一个批量帧
+  const handleBatch = (payload: Buffer) => {
+    batchReplies = [];
+    try {
+      let offset = 0;
+      while (offset + 4 <= payload.length) {
+        const length = payload.readUInt32BE(offset);
+        // 长度越界时无法定位后面的消息，丢弃剩余部分
+        if (length > payload.length - offset - 4) {
+          console.error('批量消息长度越界，丢弃剩余消息');
+          break;
+        }
+        handleJsonMessage(payload.subarray(offset + 4, offset + 4 + length));
+        offset += 4 + length;
+      }
+    } finally {
+      const replies = batchReplies || [];
+      batchReplies = null;
+      if (peerPayloadTypes.has(PAYLOAD_BATCH)) {
+        if (replies.length > 0) {
+          writeFrame(_encodeBatchFrame(replies, encoding));
+        }
+      } else {
+        replies.forEach((reply) => writeFrame(_encodeFrame(PAYLOAD_JSON, [reply], encoding)));
+      }
+    }
+  };
+
   const messageServer = new AgentMessageServer()
   messageServer.listen(newSocket)
 
+  // 从当前位置之后查找下一个同步标记的首字节（Buffer.indexOf内部使用memchr），找不到时丢弃全部已缓冲的数据
+  const resync = () => {
+    const next = buffer.indexOf(SYNC_MARKER[0], 1);
+    const skipped = next < 0 ? buffer.length : next;
+    console.error(`数据流失步，跳过 ${skipped} 字节后重新同步`);
+    buffer = buffer.subarray(skipped);
+  };
+
   socket.on('data', async (data: Buffer) => {
     buffer = Buffer.concat([buffer, data])
-    while (buffer.length >= 4) {
-      const length = buffer.readUInt32BE(0);
-      const fullMessageLength = 4 + 2 + length + 4; // 长度头+类型+数据+CRC
+    while (buffer.length > 0) {
+      let offset = 0;
+      if (buffer[0] === SYNC_MARKER[0]) {
+        if (buffer.length < SYNC_MARKER.length) {
+          break;
+        }
+        if (buffer[1] !== SYNC_MARKER[1]) {
+          resync();
+          continue;
+        }
+        offset = SYNC_MARKER.length;
+        synced = true;
+      } else if (synced) {
+        resync();
+        continue;
+      }
+      if (buffer.length < offset + 6) {
+        break;
+      }
+      const length = buffer.readUInt32BE(offset);
+      // 长度超过上限时不等待其数据：带标记的帧重新同步，旧版帧无法定位下一帧，断开连接
+      const oversized = length > MAX_PAYLOAD_SIZE + PAYLOAD_HEADROOM;
+      if (offset > 0 && (oversized || !_isWellFormedFlags(buffer[offset + 5]))) {
+        resync();
+        continue;
+      }
+      if (oversized) {
+        console.error(`帧长度 ${length} 超过上限，断开连接`);
+        buffer = Buffer.alloc(0);
+        socket.destroy();
+        return;
+      }
+      const fullMessageLength = offset + 4 + 2 + length + 4; // 同步标记+长度头+类型+数据+CRC
       if (buffer.length >= fullMessageLength) {
-        const message = buffer.slice(4, 6 + length);
-        const receivedCrc = buffer.readUInt32BE(6 + length);
-        const calculatedCrc = _calculateCRC32(message);
-        if (receivedCrc !== calculatedCrc) {
-          // 如果CRC校验失败，则丢弃当前消息
+        const message = buffer.slice(offset + 4, offset + 6 + length);
+        const receivedCrc = buffer.readUInt32BE(offset + 6 + length);
+        // 校验模式由客户端在标志位中声明
+        const frameMode = _checksumModeFromFlags(message[1]);
+        if (frameMode === null || receivedCrc !== _calculateChecksum(message, frameMode)) {
+          // 如果CRC校验失败，则丢弃当前消息；带标记的帧长度本身可能有误，
+          // 按长度跳过后紧跟同步标记（或暂无后续数据）才整帧跳过，否则只跳过标记后重新查找
+          const resyncHere = offset > 0 && buffer.length > fullMessageLength && buffer[fullMessageLength] !== SYNC_MARKER[0];
+          buffer = buffer.slice(resyncHere ? offset : fullMessageLength);
+          continue;
+        }
+        // 解析消息内容，按负载类型分发；压缩帧先解压
+        const type = message[0];
+        const codec = _compressionFromFlags(message[1]);
+        const payload = codec === CompressionCodec.None ? message.slice(2) : _decompress(message.slice(2), codec);
+        if (!payload) {
+          console.error('解压失败，丢弃消息');
           buffer = buffer.slice(fullMessageLength);
           continue;
         }
-        // 解析消息内容
-        const type = message.readUInt16BE(0);
-        const payload = message.slice(2);
-        const obj = JSON.parse(payload.toString())
-        newSocket.exec(obj.event, obj.data)
+        if (type === PAYLOAD_CHUNK) {
+          handleChunk(payload);
+          buffer = buffer.slice(fullMessageLength);
+          continue;
+        }
+        if (BINARY_PAYLOAD_TYPES.includes(type)) {
+          const binary = _splitBinaryPayload(payload);
+          if (binary) {
+            newSocket.exec(binary.meta.event, binary.meta.data, binary.data, binary.meta.requestId);
+          } else {
+            console.error('解析二进制消息元数据失败，丢弃消息');
+          }
+          buffer = buffer.slice(fullMessageLength);
+          continue;
+        }
+        if (type === PAYLOAD_BATCH) {
+          handleBatch(payload);
+        } else {
+          handleJsonMessage(payload);
+        }
         buffer = buffer.slice(fullMessageLength);
       } else {
         break; // 等待更多数据
       }
     };
-    // newSocket.emit('execute_command', JSON.stringify({
-    //   type: "browser",
-    //   command: "帮我打开boss直聘并登录",
-    // }))
-
-    // newSocket.emit('stop_agent')
   })
   // 客户端断开连接
   socket.on('close', () => {
     console.log('C++客户端已断开');
+    outgoingStreams.length = 0;
+    incomingStreams.clear();
+    if (sharedRingOwner === socket) {
+      sharedRingOwner = null;
+    }
     newSocket.exec('disconnect')
   });
   
@@ -110,7 +685,10 @@ server.on('connection', (socket: net.Socket) => {
   socket.on('error', (err: Error) => {
     console.error('连接错误:', err);
   });
-});
+};
+
+server.on('connection', handleConnection);
+const localServer = net.createServer(handleConnection);
 
 // 服务器错误处理
 server.on('error', (err: NodeJS.ErrnoException) => {
@@ -121,9 +699,14 @@ server.on('error', (err: NodeJS.ErrnoException) => {
   }
 });
 
+localServer.on('error', (err: Error) => {
+  console.error('本地套接字服务器错误:', err);
+});
+
 // 优雅关闭处理
 process.on('SIGTERM', () => {
   console.log('收到SIGTERM信号，准备关闭服务器...');
+  localServer.close();
   server.close(() => {
     console.log('TCP服务器已关闭，退出进程');
     process.exit(0);
@@ -137,7 +720,23 @@ process.on('SIGTERM', () => {
 });
 
 const start = () => {
-  // 启动服务器
+  // 继承的socketpair在进程启动时就已连接，没有监听和连接的竞争
+  if (IPC_FD) {
+    const socket = new net.Socket({ fd: Number(IPC_FD), readable: true, writable: true });
+    console.log(`使用继承的socketpair (fd ${IPC_FD})`);
+    handleConnection(socket);
+  }
+  // 本地套接字，socketpair断开后客户端改连这里
+  if (IPC_PATH) {
+    // 上次异常退出时留下的套接字文件
+    if (process.platform !== 'win32' && fs.existsSync(IPC_PATH)) {
+      fs.unlinkSync(IPC_PATH);
+    }
+    localServer.listen(IPC_PATH, () => {
+      console.log(`Node.js本地套接字服务器启动成功，监听 ${IPC_PATH}`);
+    });
+  }
+  // TCP作为后备，供单独启动的客户端使用
   server.listen(PORT, HOST, () => {
     console.log(`Node.js TCP服务器启动成功，监听 ${HOST}:${PORT}`);
     console.log('等待C++客户端连接...');
@@ -0,0 +1,49 @@
+// CRC32C（Castagnoli）slice-by-8实现，与C++端 crc32c.cpp 保持一致
+
+const POLYNOMIAL = 0x82f63b78;
+
+const TABLES: Uint32Array[] = (() => {
+  const tables: Uint32Array[] = [];
+  for (let slice = 0; slice < 8; slice++) {
+    tables.push(new Uint32Array(256));
+  }
+  for (let i = 0; i < 256; i++) {
+    let crc = i;
+    for (let bit = 0; bit < 8; bit++) {
+      crc = crc & 1 ? (crc >>> 1) ^ POLYNOMIAL : crc >>> 1;
+    }
+    tables[0][i] = crc >>> 0;
+  }
+  for (let i = 0; i < 256; i++) {
+    for (let slice = 1; slice < 8; slice++) {
+      const prev = tables[slice - 1][i];
+      tables[slice][i] = ((prev >>> 8) ^ tables[0][prev & 0xff]) >>> 0;
+    }
+  }
+  return tables;
+})();
+
+export function crc32c (data: Buffer, initial = 0): number {
+  const [t0, t1, t2, t3, t4, t5, t6, t7] = TABLES;
+  let crc = ~initial >>> 0;
+  let offset = 0;
+  const end8 = data.length - (data.length % 8);
+
+  while (offset < end8) {
+    const lo = (data[offset] | (data[offset + 1] << 8) | (data[offset + 2] << 16) | (data[offset + 3] << 24)) ^ crc;
+    const hi = data[offset + 4] | (data[offset + 5] << 8) | (data[offset + 6] << 16) | (data[offset + 7] << 24);
+    crc = t7[lo & 0xff] ^
+      t6[(lo >>> 8) & 0xff] ^
+      t5[(lo >>> 16) & 0xff] ^
+      t4[lo >>> 24] ^
+      t3[hi & 0xff] ^
+      t2[(hi >>> 8) & 0xff] ^
+      t1[(hi >>> 16) & 0xff] ^
+      t0[hi >>> 24];
+    offset += 8;
+  }
+  while (offset < data.length) {
+    crc = (crc >>> 8) ^ t0[(crc ^ data[offset++]) & 0xff];
+  }
+  return ~crc >>> 0;
+}
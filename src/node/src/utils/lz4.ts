@@ -0,0 +1,164 @@
+// LZ4块格式（不含帧头）的压缩和解压，与C++端 LZ4_compress_default / LZ4_decompress_safe 的输出互通
+// 每个序列：[1字节token：高4位字面量长度，低4位匹配长度-4][扩展长度][字面量][2字节小端偏移][扩展长度]
+// 块以一段只有字面量的序列结束：最后5字节总是字面量，最后一个匹配不晚于结尾前12字节开始
+
+const MIN_MATCH = 4;
+const LAST_LITERALS = 5;
+const MF_LIMIT = 12;
+const MAX_OFFSET = 65535;
+const HASH_LOG = 16;
+// 连续未命中时逐渐加大步长，不可压缩的数据不会逐字节查找
+const SKIP_TRIGGER = 6;
+
+export function lz4CompressBound (length: number): number {
+  return length + Math.floor(length / 255) + 16;
+}
+
+// 扩展长度：token中的4位为15时，后面依次写255，最后写余数
+function writeLength (out: Buffer, op: number, length: number): number {
+  while (length >= 255) {
+    out[op++] = 255;
+    length -= 255;
+  }
+  out[op++] = length;
+  return op;
+}
+
+function writeSequence (out: Buffer, op: number, src: Buffer, anchor: number, literalLength: number,
+                        offset: number, matchLength: number): number {
+  const tokenPos = op++;
+  const matchCode = matchLength - MIN_MATCH;
+  let token = 0;
+  if (literalLength >= 15) {
+    token = 15 << 4;
+    op = writeLength(out, op, literalLength - 15);
+  } else {
+    token = literalLength << 4;
+  }
+  op += src.copy(out, op, anchor, anchor + literalLength);
+  if (matchLength > 0) {
+    out[op++] = offset & 0xff;
+    out[op++] = offset >>> 8;
+    if (matchCode >= 15) {
+      token |= 15;
+      op = writeLength(out, op, matchCode - 15);
+    } else {
+      token |= matchCode;
+    }
+  }
+  out[tokenPos] = token;
+  return op;
+}
+
+// 贪心匹配，哈希表记录每个4字节序列最近出现的位置
+export function lz4CompressBlock (src: Buffer): Buffer {
+  const length = src.length;
+  const out = Buffer.allocUnsafe(lz4CompressBound(length));
+  let op = 0;
+  let anchor = 0;
+
+  if (length > MF_LIMIT) {
+    const table = new Int32Array(1 << HASH_LOG).fill(-1);
+    const matchLimit = length - LAST_LITERALS;
+    const lastMatchStart = length - MF_LIMIT;
+    let ip = 0;
+    let misses = 0;
+    while (ip <= lastMatchStart) {
+      const sequence = src.readUInt32LE(ip);
+      const hash = Math.imul(sequence, 2654435761) >>> (32 - HASH_LOG);
+      const ref = table[hash];
+      table[hash] = ip;
+      if (ref < 0 || ip - ref > MAX_OFFSET || src.readUInt32LE(ref) !== sequence) {
+        ip += 1 + (misses++ >> SKIP_TRIGGER);
+        continue;
+      }
+      misses = 0;
+
+      // 向前扩展到上一个序列的结尾，向后扩展到最后5字节之前
+      let start = ip;
+      let matchRef = ref;
+      while (start > anchor && matchRef > 0 && src[start - 1] === src[matchRef - 1]) {
+        start--;
+        matchRef--;
+      }
+      let end = ip + MIN_MATCH;
+      let refEnd = ref + MIN_MATCH;
+      while (end < matchLimit && src[end] === src[refEnd]) {
+        end++;
+        refEnd++;
+      }
+
+      op = writeSequence(out, op, src, anchor, start - anchor, start - matchRef, end - start);
+      anchor = end;
+      ip = end;
+    }
+  }
+
+  op = writeSequence(out, op, src, anchor, length - anchor, 0, 0);
+  return out.subarray(0, op);
+}
+
+// 解压到originalLength字节，数据损坏（越界、偏移无效、长度不符）时返回null
+export function lz4DecompressBlock (src: Buffer, originalLength: number): Buffer | null {
+  const out = Buffer.allocUnsafe(originalLength);
+  let ip = 0;
+  let op = 0;
+  while (ip < src.length) {
+    const token = src[ip++];
+
+    let literalLength = token >>> 4;
+    if (literalLength === 15) {
+      let byte = 255;
+      while (byte === 255) {
+        if (ip >= src.length) {
+          return null;
+        }
+        byte = src[ip++];
+        literalLength += byte;
+      }
+    }
+    if (literalLength > src.length - ip || literalLength > originalLength - op) {
+      return null;
+    }
+    op += src.copy(out, op, ip, ip + literalLength);
+    ip += literalLength;
+    if (ip === src.length) {
+      break;
+    }
+
+    if (src.length - ip < 2) {
+      return null;
+    }
+    const offset = src[ip] | (src[ip + 1] << 8);
+    ip += 2;
+    if (offset === 0 || offset > op) {
+      return null;
+    }
+    let matchLength = token & 15;
+    if (matchLength === 15) {
+      let byte = 255;
+      while (byte === 255) {
+        if (ip >= src.length) {
+          return null;
+        }
+        byte = src[ip++];
+        matchLength += byte;
+      }
+    }
+    matchLength += MIN_MATCH;
+    if (matchLength > originalLength - op) {
+      return null;
+    }
+
+    // 偏移小于匹配长度时源和目标重叠，逐字节复制以重复前面的数据
+    let ref = op - offset;
+    if (offset >= matchLength) {
+      op += out.copy(out, op, ref, ref + matchLength);
+    } else {
+      for (let i = 0; i < matchLength; i++) {
+        out[op++] = out[ref++];
+      }
+    }
+  }
+  return op === originalLength ? out : null;
+}
@@ -0,0 +1,69 @@
+// 共享内存环形缓冲区的写端，布局与C++端 sharedring.h 保持一致
+// [64字节头部][数据区]，头部为小端：魔数、版本、容量（2的幂）、读位置（C++端处理完后推进）
+// 位置是取模前的累计字节数（32位回绕），一段数据在数据区内总是连续的，尾部放不下时从数据区开头写
+import * as fs from 'fs';
+
+const HEADER_SIZE = 64;
+const MAGIC = 0x52534741; // "AGSR"
+const VERSION = 1;
+const READ_POSITION_OFFSET = 12;
+
+export class SharedRing {
+  private writePosition = 0;
+  private readonly positionBuffer = Buffer.alloc(4);
+
+  private constructor(private readonly fd: number, readonly capacity: number) {}
+
+  // 打开父进程继承的描述符，头部不匹配时返回null
+  static open(fd: number): SharedRing | null {
+    try {
+      const header = Buffer.alloc(16);
+      if (fs.readSync(fd, header, 0, header.length, 0) !== header.length
+        || header.readUInt32LE(0) !== MAGIC || header.readUInt32LE(4) !== VERSION) {
+        return null;
+      }
+      const capacity = header.readUInt32LE(8);
+      if (capacity === 0 || capacity > 0x80000000 || (capacity & (capacity - 1)) !== 0) {
+        return null;
+      }
+      return new SharedRing(fd, capacity);
+    } catch (error) {
+      console.error('打开共享内存失败:', error);
+      return null;
+    }
+  }
+
+  // 新连接开始使用时调用：之前连接上未处理的描述符不会再被读取，剩余空间全部收回
+  reset() {
+    this.writePosition = this.readPosition();
+  }
+
+  // 写入一段数据，返回它的位置；空间不足时返回null，由调用方改为通过连接发送
+  write(data: Buffer): number | null {
+    const length = data.length;
+    if (length === 0 || length > this.capacity) {
+      return null;
+    }
+    const readPosition = this.readPosition();
+    // 读端跳过了无效的描述符，读位置越过了写位置：从读位置继续写
+    if (((this.writePosition - readPosition) >>> 0) > this.capacity) {
+      this.writePosition = readPosition;
+    }
+    let position = this.writePosition;
+    const offset = position & (this.capacity - 1);
+    if (offset + length > this.capacity) {
+      position = (position + this.capacity - offset) >>> 0;
+    }
+    if (((position + length - readPosition) >>> 0) > this.capacity) {
+      return null;
+    }
+    fs.writeSync(this.fd, data, 0, length, HEADER_SIZE + (position & (this.capacity - 1)));
+    this.writePosition = (position + length) >>> 0;
+    return position;
+  }
+
+  private readPosition() {
+    fs.readSync(this.fd, this.positionBuffer, 0, 4, READ_POSITION_OFFSET);
+    return this.positionBuffer.readUInt32LE(0);
+  }
+}